@@ -2,6 +2,7 @@
 
 #include "core.hpp"
 #include "rendering/renderer.hpp"
+#include "rendering/texture.hpp"
 
 #include <glm/glm.hpp>
 
@@ -82,6 +83,29 @@ namespace app::core
     f32 cam_max_zoom = 2.0f;
     f32 cam_min_zoom = 100.0f;
 
+    // Tile painted under the cursor while the left mouse button is held, None when painting is off
+    game::TileType paint_tile = game::TileType::None;
+
+    void handle_paint_input(input::Input& input, const gfx::Renderer& renderer, game::World& world)
+    {
+        if (paint_tile == game::TileType::None || ImGui::GetIO().WantCaptureMouse || !input.on_ms_btn_held(GLFW_MOUSE_BUTTON_LEFT))
+        {
+            return;
+        }
+
+        const auto world_pos = renderer.screen_to_world(input.get_cursor_pos()) / world.get_tile_size();
+        if (world_pos.x < 0.0f || world_pos.y < 0.0f)
+        {
+            return;
+        }
+
+        const glm::uvec2 tile_coord = { static_cast<u32>(world_pos.x), static_cast<u32>(world_pos.y) };
+        if (world.is_valid_coord(tile_coord) && world.get_tile(tile_coord.x, tile_coord.y) != paint_tile)
+        {
+            world.set_tile(tile_coord.x, tile_coord.y, paint_tile);
+        }
+    }
+
     void handle_camera_input(input::Input& input, f32 delta_time)
     {
         // Movement
@@ -112,6 +136,69 @@ namespace app::core
         cam_ortho_size = glm::mix(cam_ortho_size, cam_ortho_size_target, delta_time * cam_move_time);
     }
 
+    // Sprite batch stress test, toggled from the Debug window
+    bool show_sprite_demo = false;
+    i32 sprite_demo_count = 200000;
+    bool sprite_demo_parallel = true;
+
+    auto hash_sprite(u32 value) -> u32
+    {
+        value ^= value >> 16;
+        value *= 0x7feb352d;
+        value ^= value >> 15;
+        value *= 0x846ca68b;
+        value ^= value >> 16;
+        return value;
+    }
+
+    void draw_sprite_demo(gfx::Batch2D& batch, const game::TextureAtlas& atlas, u32 sprite_count, f32 time, JobSystem* job_system)
+    {
+        // Trees scattered over a forest with units wandering between them, all y-sorted on one layer so each covers the
+        // sprites behind it. Unit shadows go on the layer below.
+        const auto& tree = atlas.get_sprite("forest_0");
+        const f32 extent = glm::sqrt(static_cast<f32>(sprite_count)) * 0.5f;
+
+        const auto draw_range = [&](u32 begin, u32 end)
+        {
+            auto& context = batch.get_thread_context();
+            context.set_sequence(begin);
+            context.set_y_sorted(true);
+            for (u32 i = begin; i < end; ++i)
+            {
+                const u32 hash = hash_sprite(i);
+                glm::vec2 position = { static_cast<f32>(hash & 0xffff) / 65535.0f, static_cast<f32>(hash >> 16) / 65535.0f };
+                position *= extent;
+
+                if (i % 4 != 0)
+                {
+                    context.set_layer(1);
+                    context.draw_quad(position, { 1.0f, 1.0f }, atlas.get_texture(), tree.MinUV, tree.MaxUV);
+                    continue;
+                }
+
+                const f32 phase = static_cast<f32>(hash % 628) * 0.01f;
+                position += glm::vec2(glm::cos(time + phase), glm::sin(time + phase)) * 0.75f;
+
+                context.set_layer(0);
+                context.draw_quad(position + glm::vec2(0.0f, 0.3f), { 0.4f, 0.15f }, { 0.0f, 0.0f, 0.0f, 0.4f });
+                context.set_layer(1);
+                context.draw_quad(position, { 0.4f, 0.4f }, { 0.9f, 0.3f + phase * 0.1f, 0.2f, 1.0f });
+            }
+        };
+
+        batch.begin_batch();
+        if (job_system != nullptr)
+        {
+            job_system->parallel_for(sprite_count, 4096, draw_range);
+        }
+        else
+        {
+            draw_range(0, sprite_count);
+        }
+        batch.end_batch();
+        batch.flush();
+    }
+
     Application::Application(const ApplicationInfo& app_info) : m_appInfo(app_info)
     {
         s_Instance = this;
@@ -139,9 +226,13 @@ namespace app::core
         m_world.set_world_size(64, 64);
 
         m_worldGenerator.set_world(m_world);
+        m_worldGenerator.set_job_system(&m_jobSystem);
 
+        m_renderer.begin_upload_batch();
         m_worldRenderer.init(m_renderer);
         m_worldRenderer.set_world(m_world);
+        m_worldRenderer.set_job_system(&m_jobSystem);
+        m_renderer.wait_for_upload(m_renderer.end_upload_batch());
 
         // Main loop
         while (m_isRunning && !m_renderer.has_window_requested_close())
@@ -164,19 +255,24 @@ namespace app::core
             handle_camera_input(m_input, m_deltaTime);
 
             m_renderer.new_frame(cam_pos, cam_ortho_size);
+
+            if (m_worldStreamer.is_running())
+            {
+                m_worldStreamer.update(m_renderer.get_view_min(), m_renderer.get_view_max());
+            }
+
+            handle_paint_input(m_input, m_renderer, m_world);
+
             m_worldRenderer.render();
 
-            /*m_batch2D.begin_batch();
-            for (f32 y = -10.0f; y < 10.0f; y += 0.25f)
+            if (show_sprite_demo)
             {
-                for (f32 x = -10.0f; x < 10.0f; x += 0.25f)
-                {
-                    glm::vec4 color = { (x + 10) / 20.0f, 0.2f, (y + 10) / 20.0f, 1.0f };
-                    m_batch2D.draw_quad({ x, y }, { 0.2f, 0.2f }, color);
-                }
+                draw_sprite_demo(m_batch2D,
+                                 m_spriteDemoAtlas,
+                                 static_cast<u32>(sprite_demo_count),
+                                 get_time(),
+                                 sprite_demo_parallel ? &m_jobSystem : nullptr);
             }
-            m_batch2D.end_batch();
-            m_batch2D.flush();*/
 
             static bool s_ImGuiShowDemo = false;
             ImGui::ShowDemoWindow(&s_ImGuiShowDemo);
@@ -190,6 +286,21 @@ namespace app::core
                 ImGui::Text("Memory Usage (bytes): %i", GetAllocationMetrics().CurrentUsage());
 
                 draw_cpu_frame_graph(get_time(), get_delta_time());
+
+                bool is_hot_reloading = m_renderer.is_shader_hot_reload_enabled();
+                if (ImGui::Checkbox("Shader Hot Reload", &is_hot_reloading))
+                {
+                    m_renderer.set_shader_hot_reload(is_hot_reloading);
+                }
+
+                ImGui::Checkbox("Sprite Demo", &show_sprite_demo);
+                if (show_sprite_demo)
+                {
+                    ImGui::DragInt("Sprites", &sprite_demo_count, 1000.0f, 0, 1000000);
+                    ImGui::Checkbox("Parallel Submission", &sprite_demo_parallel);
+                    ImGui::Text("Sprite Draw Calls: %i", m_batch2D.get_draw_call_count());
+                    ImGui::Text("Sprite Sort: %.3fms", m_batch2D.get_sort_time());
+                }
             }
 
             if (ImGui::Begin("Game"))
@@ -212,31 +323,101 @@ namespace app::core
                 static i32 steps = 1;
                 ImGui::DragInt("Steps", &steps, 1.0f, 1, 10);
 
-                if (ImGui::Button("Generate"))
+                static bool s_isMultithreaded = true;
+                if (ImGui::Checkbox("Multithreaded", &s_isMultithreaded))
                 {
-                    m_worldGenerator.reset();
-                    m_worldGenerator.generate(steps);
-                    m_worldRenderer.force_rebuild();
+                    m_worldGenerator.set_job_system(s_isMultithreaded ? &m_jobSystem : nullptr);
+                    m_worldRenderer.set_job_system(s_isMultithreaded ? &m_jobSystem : nullptr);
                 }
 
-                if (ImGui::Button("Step"))
+                static bool s_isStreaming = false;
+                if (ImGui::Checkbox("Streaming", &s_isStreaming))
                 {
-                    m_worldGenerator.step();
+                    if (s_isStreaming)
+                    {
+                        m_world.set_world_size(game::StreamingWorldSize, game::StreamingWorldSize);
+                        m_worldStreamer.start(m_world, m_worldGenerator, m_jobSystem);
+
+                        const f32 centre = game::StreamingWorldSize * 0.5f * m_world.get_tile_size();
+                        cam_pos = { centre, centre, 0.0f };
+                    }
+                    else
+                    {
+                        m_worldStreamer.stop();
+                        m_world.set_world_size(64, 64);
+                        m_worldGenerator.set_world(m_world);
+
+                        cam_pos = { 32, 32, 0 };
+                    }
+                    cam_pos_target = cam_pos;
                     m_worldRenderer.force_rebuild();
                 }
 
-                if (ImGui::Button("Reset"))
+                if (s_isStreaming)
                 {
-                    m_worldGenerator.reset();
-                    m_worldRenderer.force_rebuild();
+                    m_worldStreamer.set_generation_steps(static_cast<u32>(steps));
+
+                    static i32 s_budgetMB = static_cast<i32>(m_worldStreamer.get_memory_budget() / (1024 * 1024));
+                    if (ImGui::DragInt("Budget (MB)", &s_budgetMB, 1.0f, 1, 4096))
+                    {
+                        m_worldStreamer.set_memory_budget(static_cast<sizet>(s_budgetMB) * 1024 * 1024);
+                    }
+
+                    ImGui::Text("Resident: %i / Pending: %i", m_worldStreamer.get_resident_count(), m_worldStreamer.get_pending_count());
                 }
+                else
+                {
+                    if (ImGui::Button("Generate"))
+                    {
+                        m_worldGenerator.reset();
+                        m_worldGenerator.generate(steps);
+                    }
+
+                    if (ImGui::Button("Step"))
+                    {
+                        m_worldGenerator.step();
+                    }
+
+                    if (ImGui::Button("Reset"))
+                    {
+                        m_worldGenerator.reset();
+                    }
+                }
+
+                const char* paint_names[] = { "Off", "Water", "Sand", "Grass", "Forest" };
+                static_assert(std::size(paint_names) == game::TileTypeCount);
+                i32 paint_index = static_cast<i32>(paint_tile);
+                if (ImGui::Combo("Paint", &paint_index, paint_names, static_cast<i32>(std::size(paint_names))))
+                {
+                    paint_tile = static_cast<game::TileType>(paint_index);
+                }
+
+                ImGui::Text("Chunks: %i (%i KB)",
+                            m_world.get_chunk_count(),
+                            static_cast<u32>(m_world.get_chunk_count() * sizeof(game::Chunk) / 1024));
 
                 ImGui::Separator();
 
                 ImGui::Text("Rendering");
 
+                const char* render_mode_names[] = { "Meshes", "Instanced", "Tilemap", "Greedy" };
+                i32 render_mode = static_cast<i32>(m_worldRenderer.get_render_mode());
+                if (ImGui::Combo("Mode", &render_mode, render_mode_names, static_cast<i32>(std::size(render_mode_names))))
+                {
+                    m_worldRenderer.set_render_mode(static_cast<game::WorldRenderMode>(render_mode));
+                }
+
+                f32 lod_threshold = m_worldRenderer.get_lod_threshold();
+                if (ImGui::DragFloat("LOD Pixels/Tile", &lod_threshold, 0.1f, 0.0f, 32.0f))
+                {
+                    m_worldRenderer.set_lod_threshold(lod_threshold);
+                }
+                ImGui::Text("Impostors: %s", m_worldRenderer.is_using_impostors() ? "Yes" : "No");
+
+                ImGui::Text("Chunks Drawn: %i / Culled: %i", m_worldRenderer.get_drawn_chunk_count(), m_worldRenderer.get_culled_chunk_count());
                 ImGui::Text("Vertices: %i", m_worldRenderer.get_vertex_count());
                 ImGui::Text("Triangles: %i", m_worldRenderer.get_triangle_count());
+                ImGui::Text("GPU Memory: %i KB", static_cast<u32>(m_worldRenderer.get_gpu_memory_usage() / 1024));
             }
 
             m_renderer.end_frame();
@@ -260,19 +441,31 @@ namespace app::core
 
     void Application::init()
     {
+        m_jobSystem.init();
+
         m_renderer.init();
+        m_renderer.set_job_system(&m_jobSystem);
+
+        // Startup assets are uploaded together and waited on once
+        m_renderer.begin_upload_batch();
         m_batch2D.init(m_renderer);
+        m_spriteDemoAtlas.init(&m_renderer, "../../assets/textures/tileset.json");
+        m_renderer.wait_for_upload(m_renderer.end_upload_batch());
 
         m_input.init(m_renderer.get_window_handle());
     }
 
     void Application::shutdown()
     {
+        m_worldStreamer.stop();
+
         m_input.shutdown();
 
         m_batch2D.shutdown();
         m_renderer.shutdown();
 
+        m_jobSystem.shutdown();
+
         g_isAppRunning = false;
     }
 
@@ -1,12 +1,15 @@
 #pragma once
 
 #include "core.hpp"
+#include "job_system.hpp"
 #include "rendering/renderer.hpp"
 #include "rendering/batch_2d.hpp"
 #include "input/input.hpp"
+#include "game/texture_atlas.hpp"
 #include "game/world.hpp"
 #include "game/world_generator.hpp"
 #include "game/world_renderer.hpp"
+#include "game/world_streamer.hpp"
 
 #include <imgui.h>
 #include <vulkan/vulkan.h>
@@ -59,14 +62,18 @@ namespace app::core
         f32 m_fpsAccumulatedTime = 0.0f;
         u32 m_fps = 0;
 
+        JobSystem m_jobSystem{};
+
         gfx::Renderer m_renderer{};
         gfx::Batch2D m_batch2D{};
+        game::TextureAtlas m_spriteDemoAtlas{};
 
         input::Input m_input{};
 
         game::World m_world{};
         game::WorldGenerator m_worldGenerator{};
         game::WorldRenderer m_worldRenderer{};
+        game::WorldStreamer m_worldStreamer{};
     };
 
 }
\ No newline at end of file
@@ -0,0 +1,203 @@
+#include "file_watcher.hpp"
+
+#include "debug.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+
+#if defined(__linux__)
+    #include <sys/inotify.h>
+    #include <unistd.h>
+#endif
+
+namespace app::core
+{
+    namespace
+    {
+        // Rescans are a directory listing and a stat per file, so they are spaced out rather than run every frame
+        constexpr auto RescanInterval = std::chrono::milliseconds(500);
+    }
+
+    struct FileWatcher::FileWatcherPimpl
+    {
+        std::filesystem::path directory{};
+        std::string extension{};
+        bool isWatching = false;
+
+#if defined(__linux__)
+        int inotifyFd = -1;
+#endif
+
+        // Rescan fallback
+        struct FileState
+        {
+            std::filesystem::file_time_type WriteTime{};
+            std::uintmax_t Size = 0;
+            bool IsReported = false;
+        };
+        std::unordered_map<std::string, FileState> files{};
+        std::chrono::steady_clock::time_point lastScan{};
+
+        bool is_watched_file(const std::filesystem::path& path) const
+        {
+            return path.extension() == extension;
+        }
+
+        // Returns the files that are new or were written since they were last reported, once their size and write time have held
+        // for a whole scan. A compiler still writing a file keeps changing them, so a partly written file is not reported.
+        auto rescan(bool is_initial_scan) -> std::vector<std::filesystem::path>
+        {
+            std::vector<std::filesystem::path> changed{};
+
+            std::error_code error{};
+            for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+            {
+                if (!entry.is_regular_file(error) || !is_watched_file(entry.path()))
+                {
+                    continue;
+                }
+
+                const auto write_time = entry.last_write_time(error);
+                if (error)
+                {
+                    continue;
+                }
+                const auto size = entry.file_size(error);
+                if (error)
+                {
+                    continue;
+                }
+
+                // Files present when watching starts are up to date
+                auto [it, is_new] = files.try_emplace(entry.path().string(), FileState{ write_time, size, is_initial_scan });
+                auto& state = it->second;
+                if (is_new)
+                {
+                    continue;
+                }
+
+                if (state.WriteTime != write_time || state.Size != size)
+                {
+                    state = { write_time, size, false };
+                }
+                else if (!state.IsReported)
+                {
+                    state.IsReported = true;
+                    changed.push_back(entry.path());
+                }
+            }
+
+            return changed;
+        }
+    };
+
+    FileWatcher::FileWatcher() : m_pimpl(new FileWatcherPimpl) {}
+
+    FileWatcher::~FileWatcher()
+    {
+        shutdown();
+    }
+
+    void FileWatcher::init(const std::filesystem::path& directory, const std::string& extension)
+    {
+        shutdown();
+
+        m_pimpl->directory = directory;
+        m_pimpl->extension = extension;
+        m_pimpl->isWatching = true;
+
+#if defined(__linux__)
+        // Close-write rather than modify, so a file is reported once it has been written in full
+        m_pimpl->inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (m_pimpl->inotifyFd >= 0 && inotify_add_watch(m_pimpl->inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) >= 0)
+        {
+            return;
+        }
+
+        LOG_WARN("FileWatcher - inotify is unavailable for <{}>, rescanning instead", directory.string());
+        if (m_pimpl->inotifyFd >= 0)
+        {
+            close(m_pimpl->inotifyFd);
+            m_pimpl->inotifyFd = -1;
+        }
+#endif
+
+        // The first scan only records the current files
+        m_pimpl->rescan(true);
+        m_pimpl->lastScan = std::chrono::steady_clock::now();
+    }
+
+    void FileWatcher::shutdown()
+    {
+#if defined(__linux__)
+        if (m_pimpl->inotifyFd >= 0)
+        {
+            close(m_pimpl->inotifyFd);
+            m_pimpl->inotifyFd = -1;
+        }
+#endif
+
+        m_pimpl->files.clear();
+        m_pimpl->isWatching = false;
+    }
+
+    bool FileWatcher::is_watching() const
+    {
+        return m_pimpl->isWatching;
+    }
+
+    auto FileWatcher::poll() -> std::vector<std::filesystem::path>
+    {
+        if (!m_pimpl->isWatching)
+        {
+            return {};
+        }
+
+        std::vector<std::filesystem::path> changed{};
+
+#if defined(__linux__)
+        if (m_pimpl->inotifyFd >= 0)
+        {
+            alignas(inotify_event) char buffer[4096];
+            while (true)
+            {
+                const auto length = read(m_pimpl->inotifyFd, buffer, sizeof(buffer));
+                if (length <= 0)
+                {
+                    break;
+                }
+
+                for (ssize_t offset = 0; offset < length;)
+                {
+                    const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                    offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+                    if (event->len == 0)
+                    {
+                        continue;
+                    }
+
+                    auto path = m_pimpl->directory / event->name;
+                    if (m_pimpl->is_watched_file(path) && std::find(changed.begin(), changed.end(), path) == changed.end())
+                    {
+                        changed.push_back(std::move(path));
+                    }
+                }
+            }
+
+            return changed;
+        }
+#endif
+
+        const auto now = std::chrono::steady_clock::now();
+        if (now - m_pimpl->lastScan >= RescanInterval)
+        {
+            m_pimpl->lastScan = now;
+            changed = m_pimpl->rescan(false);
+        }
+
+        return changed;
+    }
+}
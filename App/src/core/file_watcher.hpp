@@ -0,0 +1,41 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace app::core
+{
+    /**
+     * Reports files in one directory that have been created or written since they were last polled.
+     * Uses inotify on Linux. Elsewhere, or if inotify is unavailable, the directory is rescanned for new files and changed sizes or
+     * modification times, and a file is reported once both have held for a whole rescan.
+     */
+    class FileWatcher
+    {
+    public:
+        FileWatcher();
+        ~FileWatcher();
+
+        /* Initialisation/Shutdown */
+
+        /* Watches the files directly in directory with the given extension, such as ".spv". */
+        void init(const std::filesystem::path& directory, const std::string& extension);
+        void shutdown();
+
+        /* Getters */
+
+        bool is_watching() const;
+
+        /* Commands */
+
+        /* Paths of the files written since the last call, each listed once. Never blocks. */
+        auto poll() -> std::vector<std::filesystem::path>;
+
+    private:
+        struct FileWatcherPimpl;
+        Owned<FileWatcherPimpl> m_pimpl;
+    };
+}
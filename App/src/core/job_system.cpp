@@ -0,0 +1,182 @@
+#include "job_system.hpp"
+
+#include "debug.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace app::core
+{
+    struct JobSystem::JobSystemPimpl
+    {
+        std::vector<std::thread> threads{};
+
+        std::mutex mutex{};
+        std::condition_variable condition{};
+        std::deque<Job> queue{};
+        bool isRunning = false;
+
+        void worker_loop()
+        {
+            while (true)
+            {
+                Job job;
+                {
+                    std::unique_lock lock(mutex);
+                    condition.wait(lock, [this] { return !isRunning || !queue.empty(); });
+                    if (!isRunning && queue.empty())
+                    {
+                        return;
+                    }
+
+                    job = std::move(queue.front());
+                    queue.pop_front();
+                }
+
+                job();
+            }
+        }
+    };
+
+    namespace
+    {
+        /* Shared between the caller and helper jobs, which may outlive the parallel_for call itself. */
+        struct ParallelForState
+        {
+            JobSystem::RangeJob job;
+            u32 count = 0;
+            u32 batchSize = 1;
+            u32 batchCount = 0;
+
+            std::atomic<u32> nextBatch = 0;
+            std::atomic<u32> doneBatches = 0;
+
+            std::mutex mutex{};
+            std::condition_variable condition{};
+
+            void run_batches()
+            {
+                u32 batch = nextBatch.fetch_add(1);
+                while (batch < batchCount)
+                {
+                    const u32 begin = batch * batchSize;
+                    const u32 end = std::min(begin + batchSize, count);
+                    job(begin, end);
+
+                    if (doneBatches.fetch_add(1) + 1 == batchCount)
+                    {
+                        std::lock_guard lock(mutex);
+                        condition.notify_all();
+                    }
+
+                    batch = nextBatch.fetch_add(1);
+                }
+            }
+        };
+    }
+
+    JobSystem::JobSystem() : m_pimpl(new JobSystemPimpl) {}
+
+    JobSystem::~JobSystem()
+    {
+        shutdown();
+    }
+
+    void JobSystem::init(u32 thread_count)
+    {
+        ASSERT(m_pimpl->threads.empty());
+
+        if (thread_count == 0)
+        {
+            thread_count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+        }
+
+        m_pimpl->isRunning = true;
+        for (u32 i = 0; i < thread_count; ++i)
+        {
+            m_pimpl->threads.emplace_back([this] { m_pimpl->worker_loop(); });
+        }
+
+        LOG_INFO("JobSystem - Started {} worker threads", thread_count);
+    }
+
+    void JobSystem::shutdown()
+    {
+        if (m_pimpl->threads.empty())
+        {
+            return;
+        }
+
+        {
+            std::lock_guard lock(m_pimpl->mutex);
+            m_pimpl->isRunning = false;
+        }
+        m_pimpl->condition.notify_all();
+
+        for (auto& thread : m_pimpl->threads)
+        {
+            thread.join();
+        }
+        m_pimpl->threads.clear();
+    }
+
+    auto JobSystem::get_thread_count() const -> u32
+    {
+        return static_cast<u32>(m_pimpl->threads.size());
+    }
+
+    void JobSystem::submit(Job job)
+    {
+        if (m_pimpl->threads.empty())
+        {
+            // No workers, run inline
+            job();
+            return;
+        }
+
+        {
+            std::lock_guard lock(m_pimpl->mutex);
+            m_pimpl->queue.push_back(std::move(job));
+        }
+        m_pimpl->condition.notify_one();
+    }
+
+    void JobSystem::parallel_for(u32 count, u32 batch_size, const RangeJob& job)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        batch_size = std::max(batch_size, 1u);
+        const u32 batch_count = (count + batch_size - 1) / batch_size;
+        if (batch_count == 1 || m_pimpl->threads.empty())
+        {
+            job(0, count);
+            return;
+        }
+
+        auto state = CreateShared<ParallelForState>();
+        state->job = job;
+        state->count = count;
+        state->batchSize = batch_size;
+        state->batchCount = batch_count;
+
+        const u32 helper_count = std::min(batch_count - 1, get_thread_count());
+        for (u32 i = 0; i < helper_count; ++i)
+        {
+            submit([state] { state->run_batches(); });
+        }
+
+        state->run_batches();
+
+        std::unique_lock lock(state->mutex);
+        state->condition.wait(lock, [&state] { return state->doneBatches.load() == state->batchCount; });
+    }
+
+}
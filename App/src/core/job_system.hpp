@@ -0,0 +1,43 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <functional>
+
+namespace app::core
+{
+    class JobSystem
+    {
+    public:
+        using Job = std::function<void()>;
+        using RangeJob = std::function<void(u32 begin, u32 end)>;
+
+        JobSystem();
+        ~JobSystem();
+
+        /* Initialisation/Shutdown */
+
+        /* A thread count of 0 uses one worker per hardware thread, minus the calling thread. */
+        void init(u32 thread_count = 0);
+        void shutdown();
+
+        /* Getters */
+
+        auto get_thread_count() const -> u32;
+
+        /* Commands */
+
+        /* Queues a job to run on a worker thread. Does not block. */
+        void submit(Job job);
+
+        /**
+         * Splits [0, count) into ranges of at most batch_size and runs them across the workers.
+         * The calling thread takes part and the call returns once every range has run.
+         */
+        void parallel_for(u32 count, u32 batch_size, const RangeJob& job);
+
+    private:
+        struct JobSystemPimpl;
+        Owned<JobSystemPimpl> m_pimpl;
+    };
+}
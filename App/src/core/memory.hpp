@@ -2,12 +2,15 @@
 
 #include "types.hpp"
 
+#include <atomic>
+
 namespace app::core
 {
     struct AllocationMetrics
     {
-        sizet TotalAllocated = 0;
-        sizet TotalFreed = 0;
+        // Updated from every thread that allocates
+        std::atomic<sizet> TotalAllocated = 0;
+        std::atomic<sizet> TotalFreed = 0;
 
         sizet CurrentUsage() const
         {
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <array>
+#include <utility>
+#include <vector>
+
+namespace app::core
+{
+    /**
+     * Stable least significant digit radix sort of items by a 64-bit key, one byte per pass.
+     * The histograms of all eight bytes are counted in a single read of the keys, and passes over a byte every key shares are
+     * skipped, so keys with only a few varying bits take only a few passes. scratch is resized to fit and left holding garbage.
+     */
+    template <typename T, typename GetKey>
+    void radix_sort(std::vector<T>& items, std::vector<T>& scratch, GetKey get_key)
+    {
+        constexpr u32 PassCount = sizeof(u64);
+        constexpr u32 BucketCount = 256;
+
+        const sizet count = items.size();
+        if (count < 2)
+        {
+            return;
+        }
+
+        std::array<std::array<u32, BucketCount>, PassCount> histograms{};
+        for (const auto& item : items)
+        {
+            const u64 key = get_key(item);
+            for (u32 pass = 0; pass < PassCount; ++pass)
+            {
+                ++histograms[pass][(key >> (pass * 8)) & 0xff];
+            }
+        }
+
+        scratch.resize(count);
+        auto* source = &items;
+        auto* destination = &scratch;
+
+        for (u32 pass = 0; pass < PassCount; ++pass)
+        {
+            auto& histogram = histograms[pass];
+
+            // Every key has the same byte here, so the pass would only copy
+            if (histogram[(get_key((*source)[0]) >> (pass * 8)) & 0xff] == count)
+            {
+                continue;
+            }
+
+            // Turn the counts into each bucket's first output index
+            u32 offset = 0;
+            for (auto& bucket : histogram)
+            {
+                const u32 bucket_count = bucket;
+                bucket = offset;
+                offset += bucket_count;
+            }
+
+            for (const auto& item : *source)
+            {
+                (*destination)[histogram[(get_key(item) >> (pass * 8)) & 0xff]++] = item;
+            }
+
+            std::swap(source, destination);
+        }
+
+        if (source != &items)
+        {
+            items.swap(scratch);
+        }
+    }
+}
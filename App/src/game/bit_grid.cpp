@@ -0,0 +1,233 @@
+#include "bit_grid.hpp"
+
+#include <array>
+#include <algorithm>
+
+namespace app::game
+{
+    namespace
+    {
+        constexpr u32 WordBits = 64;
+        constexpr u32 NeighbourCount = 8;
+
+        /* Mask of the bits in the word starting at `word_start` whose cell index lies within [lo, hi). */
+        auto range_mask(i64 word_start, i64 lo, i64 hi) -> u64
+        {
+            const i64 first = std::clamp<i64>(lo - word_start, 0, WordBits);
+            const i64 last = std::clamp<i64>(hi - word_start, 0, WordBits);
+            if (last <= first)
+            {
+                return 0;
+            }
+
+            const u64 below_last = last == WordBits ? ~u64(0) : (u64(1) << last) - 1;
+            const u64 below_first = (u64(1) << first) - 1;
+            return below_last & ~below_first;
+        }
+
+        /* Bit j of the result is cell (64 * i + j + offset) of src. Words outside the grid read as zero. */
+        struct ShiftedRead
+        {
+            i64 offset = 0;
+            i64 wordOffset = 0;
+            u32 bitShift = 0;
+
+            explicit ShiftedRead(i64 cell_offset) : offset(cell_offset)
+            {
+                // Floor division so negative offsets pick the word below.
+                wordOffset = cell_offset >= 0 ? cell_offset / WordBits : -((-cell_offset + WordBits - 1) / WordBits);
+                bitShift = static_cast<u32>(cell_offset - wordOffset * WordBits);
+            }
+
+            auto read_unchecked(const u64* words, i64 i) const -> u64
+            {
+                const u64 lo = words[i + wordOffset];
+                const u64 hi = words[i + wordOffset + 1];
+                // Split the upper shift in two so a zero bit shift never shifts by 64.
+                return (lo >> bitShift) | ((hi << 1) << (WordBits - 1 - bitShift));
+            }
+
+            auto read_checked(const u64* words, i64 word_count, i64 i) const -> u64
+            {
+                const i64 lo_index = i + wordOffset;
+                const i64 hi_index = lo_index + 1;
+                const u64 lo = lo_index >= 0 && lo_index < word_count ? words[lo_index] : 0;
+                const u64 hi = hi_index >= 0 && hi_index < word_count ? words[hi_index] : 0;
+                return (lo >> bitShift) | ((hi << 1) << (WordBits - 1 - bitShift));
+            }
+        };
+
+        /* Bit-sliced "count >= threshold" over the 4-bit count b3..b0, branch free so it stays vectorisable. */
+        auto count_at_least(u64 b0, u64 b1, u64 b2, u64 b3, u32 threshold) -> u64
+        {
+            const std::array<u64, 4> bits{ b0, b1, b2, b3 };
+
+            u64 greater = 0;
+            u64 equal = ~u64(0);
+            for (i32 i = 3; i >= 0; --i)
+            {
+                const u64 threshold_bit = u64(0) - ((threshold >> i) & 1);
+                greater |= equal & bits[i] & ~threshold_bit;
+                equal &= ~(bits[i] ^ threshold_bit);
+            }
+            return greater | equal;
+        }
+
+        /* Flip mask for one word given the 8 "neighbour differs from centre" bit-planes. */
+        auto flip_mask(const std::array<u64, NeighbourCount>& n, u32 threshold) -> u64
+        {
+            // Carry-save adder tree: 8 one-bit inputs into a 4-bit count.
+            const u64 s0 = n[0] ^ n[1] ^ n[2];
+            const u64 c0 = (n[0] & n[1]) | (n[2] & (n[0] ^ n[1]));
+            const u64 s1 = n[3] ^ n[4] ^ n[5];
+            const u64 c1 = (n[3] & n[4]) | (n[5] & (n[3] ^ n[4]));
+            const u64 s2 = n[6] ^ n[7];
+            const u64 c2 = n[6] & n[7];
+
+            const u64 b0 = s0 ^ s1 ^ s2;
+            const u64 c3 = (s0 & s1) | (s2 & (s0 ^ s1));
+
+            const u64 t0 = c0 ^ c1 ^ c2;
+            const u64 d0 = (c0 & c1) | (c2 & (c0 ^ c1));
+            const u64 b1 = t0 ^ c3;
+            const u64 d1 = t0 & c3;
+
+            const u64 b2 = d0 ^ d1;
+            const u64 b3 = d0 & d1;
+
+            return count_at_least(b0, b1, b2, b3, threshold);
+        }
+    }
+
+    void BitGrid::resize(u32 width, u32 height)
+    {
+        m_width = width;
+        m_height = height;
+        m_cellCount = static_cast<u64>(width) * height;
+        m_words.assign(static_cast<sizet>((m_cellCount + WordBits - 1) / WordBits), 0);
+    }
+
+    void BitGrid::clear()
+    {
+        std::fill(m_words.begin(), m_words.end(), 0);
+    }
+
+    auto BitGrid::get_width() const -> u32
+    {
+        return m_width;
+    }
+
+    auto BitGrid::get_height() const -> u32
+    {
+        return m_height;
+    }
+
+    auto BitGrid::get_cell_count() const -> u64
+    {
+        return m_cellCount;
+    }
+
+    auto BitGrid::get_word_count() const -> u32
+    {
+        return static_cast<u32>(m_words.size());
+    }
+
+    bool BitGrid::get(u64 index) const
+    {
+        ASSERT(index < m_cellCount);
+        return (m_words[index / WordBits] >> (index % WordBits)) & 1;
+    }
+
+    void BitGrid::set(u64 index, bool value)
+    {
+        ASSERT(index < m_cellCount);
+        const u64 bit = u64(1) << (index % WordBits);
+        auto& word = m_words[index / WordBits];
+        word = value ? (word | bit) : (word & ~bit);
+    }
+
+    auto BitGrid::get_words() -> u64*
+    {
+        return m_words.data();
+    }
+
+    auto BitGrid::get_words() const -> const u64*
+    {
+        return m_words.data();
+    }
+
+    void step_automaton(const BitGrid& src, BitGrid& dst, u32 word_begin, u32 word_end, u32 threshold)
+    {
+        ASSERT(src.get_width() == dst.get_width() && src.get_height() == dst.get_height());
+        ASSERT(word_end <= src.get_word_count());
+
+        const i64 width = src.get_width();
+        const i64 cell_count = static_cast<i64>(src.get_cell_count());
+        const i64 word_count = src.get_word_count();
+
+        const std::array<ShiftedRead, NeighbourCount> reads{
+            ShiftedRead(-width - 1), ShiftedRead(-width), ShiftedRead(-width + 1), ShiftedRead(-1),
+            ShiftedRead(1),          ShiftedRead(width - 1), ShiftedRead(width),  ShiftedRead(width + 1),
+        };
+
+        const u64* in = src.get_words();
+        u64* out = dst.get_words();
+
+        // Words whose whole neighbourhood lies inside the grid need no bounds checks or masking.
+        // The interior loop is branch free so the compiler can vectorise it.
+        const i64 interior_begin = std::clamp<i64>((width + 1 + WordBits - 1) / WordBits + 1, word_begin, word_end);
+        const i64 interior_end = std::clamp<i64>((cell_count - width - 1) / WordBits - 1, interior_begin, word_end);
+
+        auto step_edge_word = [&](i64 i)
+        {
+            const i64 word_start = i * WordBits;
+            const u64 centre = in[i];
+
+            std::array<u64, NeighbourCount> differs{};
+            for (u32 n = 0; n < NeighbourCount; ++n)
+            {
+                const auto& read = reads[n];
+                const u64 in_bounds = range_mask(word_start, -read.offset, cell_count - read.offset);
+                differs[n] = (read.read_checked(in, word_count, i) ^ centre) & in_bounds;
+            }
+
+            const u64 valid = range_mask(word_start, 0, cell_count);
+            out[i] = (centre ^ flip_mask(differs, threshold)) & valid;
+        };
+
+        for (i64 i = word_begin; i < interior_begin; ++i)
+        {
+            step_edge_word(i);
+        }
+
+        // Hoist the read parameters into locals so the loop body only touches the word arrays.
+        std::array<i64, NeighbourCount> word_offsets{};
+        std::array<u32, NeighbourCount> bit_shifts{};
+        for (u32 n = 0; n < NeighbourCount; ++n)
+        {
+            word_offsets[n] = reads[n].wordOffset;
+            bit_shifts[n] = reads[n].bitShift;
+        }
+
+        for (i64 i = interior_begin; i < interior_end; ++i)
+        {
+            const u64 centre = in[i];
+
+            std::array<u64, NeighbourCount> differs{};
+            for (u32 n = 0; n < NeighbourCount; ++n)
+            {
+                const u64 lo = in[i + word_offsets[n]];
+                const u64 hi = in[i + word_offsets[n] + 1];
+                differs[n] = ((lo >> bit_shifts[n]) | ((hi << 1) << (WordBits - 1 - bit_shifts[n]))) ^ centre;
+            }
+
+            out[i] = centre ^ flip_mask(differs, threshold);
+        }
+
+        for (i64 i = std::max<i64>(interior_end, word_begin); i < word_end; ++i)
+        {
+            step_edge_word(i);
+        }
+    }
+
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "core/core.hpp"
+
+#include <vector>
+
+namespace app::game
+{
+    /**
+     * A grid of single-bit cells packed into 64-bit words.
+     * Cells are stored in row-major order as one continuous bit stream, so rows are not word aligned.
+     * Padding bits past the last cell are always kept at zero.
+     */
+    class BitGrid
+    {
+    public:
+        BitGrid() = default;
+        ~BitGrid() = default;
+
+        void resize(u32 width, u32 height);
+        void clear();
+
+        /* Getters */
+
+        auto get_width() const -> u32;
+        auto get_height() const -> u32;
+
+        auto get_cell_count() const -> u64;
+        auto get_word_count() const -> u32;
+
+        bool get(u64 index) const;
+        void set(u64 index, bool value);
+
+        auto get_words() -> u64*;
+        auto get_words() const -> const u64*;
+
+    private:
+        u32 m_width = 0;
+        u32 m_height = 0;
+        u64 m_cellCount = 0;
+        std::vector<u64> m_words{};
+    };
+
+    /**
+     * Runs one step of the water/ground automaton, writing the words [word_begin, word_end) of dst.
+     *
+     * A cell flips to the other type when at least `threshold` of its 8 neighbours are of the other type.
+     * Neighbours are addressed by linear index (x +/- 1 wraps onto the adjacent row) and cells outside
+     * the grid never count, matching the original per-cell implementation exactly.
+     * Word ranges are independent, so disjoint ranges may be processed concurrently.
+     */
+    void step_automaton(const BitGrid& src, BitGrid& dst, u32 word_begin, u32 word_end, u32 threshold);
+}
@@ -3,9 +3,13 @@
 #include "rendering/renderer.hpp"
 #include "rendering/texture.hpp"
 
+#include <stb_image.h>
+
 #include <nlohmann/json.hpp>
 using json = nlohmann::json;
 
+#include <algorithm>
+#include <array>
 #include <fstream>
 #include <string>
 
@@ -29,9 +33,17 @@ namespace app::game
             texture_path /= texture_file;
         }
 
-        // Load atlas texture
+        // Load atlas texture, keeping the texels until sprite colours have been averaged
+        int width, height, channels;
+        byte* pixels = stbi_load(texture_path.string().c_str(), &width, &height, &channels, 4);
+        if (pixels == nullptr)
+        {
+            LOG_ERROR("TextureAtlas - Failed to load image <{}>!", texture_path.string());
+            return;
+        }
+
         m_texture = renderer->create_texture();
-        m_texture->init(texture_path.string());
+        m_texture->init(static_cast<u32>(width), static_cast<u32>(height), vk::Format::eR8G8B8A8Srgb, pixels);
         const glm::vec2 textureSize = { m_texture->get_width(), m_texture->get_height() };
 
         auto sprites = data["sprites"];
@@ -46,8 +58,29 @@ namespace app::game
             sprite.MinUV = glm::vec2{ sprite.x, sprite.y } / textureSize;
             sprite.MaxUV = sprite.MinUV + glm::vec2{ sprite.width, sprite.height } / textureSize;
 
+            std::array<u64, 4> sum{};
+            for (u32 y = sprite.y; y < sprite.y + sprite.height; ++y)
+            {
+                for (u32 x = sprite.x; x < sprite.x + sprite.width; ++x)
+                {
+                    const byte* texel = &pixels[(x + y * static_cast<u32>(width)) * 4];
+                    for (u32 i = 0; i < 4; ++i)
+                    {
+                        sum[i] += texel[i];
+                    }
+                }
+            }
+
+            const u64 texel_count = std::max<u64>(static_cast<u64>(sprite.width) * sprite.height, 1);
+            for (u32 i = 0; i < 4; ++i)
+            {
+                sprite.AverageColor[i] = static_cast<u8>(sum[i] / texel_count);
+            }
+
             m_spriteMap[sprite.Name] = static_cast<u32>(m_sprites.size() - 1);
         }
+
+        stbi_image_free(pixels);
     }
 
     auto TextureAtlas::get_texture() const -> gfx::Texture*
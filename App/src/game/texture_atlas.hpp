@@ -2,6 +2,8 @@
 
 #include "core/core.hpp"
 
+#include <glm/ext/vector_uint4_sized.hpp>
+
 #include <string>
 
 namespace app
@@ -24,6 +26,9 @@ namespace app
 
             glm::vec2 MinUV{};
             glm::vec2 MaxUV{};
+
+            // Mean of the sprite's texels, used where the sprite is too small on screen to draw
+            glm::u8vec4 AverageColor{};
         };
 
         class TextureAtlas
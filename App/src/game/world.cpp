@@ -1,42 +1,38 @@
 #include "world.hpp"
 
+#include <algorithm>
+
 namespace app::game
 {
+    auto get_tile_sprite_name(TileType type) -> const char*
+    {
+        switch (type)
+        {
+            case TileType::Water: return "water_0";
+            case TileType::Sand: return "sand_0";
+            case TileType::Grass: return "grass_0";
+            case TileType::Forest: return "forest_0";
+            default: return nullptr;
+        }
+    }
+
     void World::set_world_size(u32 width, u32 height)
     {
         m_worldWidth = width;
         m_worldHeight = height;
 
-        const u32 size = m_worldWidth * m_worldHeight;
-        m_tiles.resize(size);
-
-        for (u32 i = 0; i < size; ++i)
-        {
-            auto& tile = m_tiles[i];
-            tile.Size = m_tileSize;
-            tile.Coord = get_coord(i);
-        }
+        clear();
     }
 
     void World::set_tile_size(f32 size)
     {
         m_tileSize = size;
-
-        for (auto& tile : m_tiles)
-        {
-            tile.Size = m_tileSize;
-        }
     }
 
     void World::clear()
     {
-        for (u32 i = 0; i < m_tiles.size(); ++i)
-        {
-            auto& tile = m_tiles[i];
-            tile.Coord = get_coord(i);
-            tile.Size = m_tileSize;
-            tile.SpriteName = "";
-        }
+        mark_all_dirty();
+        m_chunks.clear();
     }
 
     auto World::get_width() const -> u32
@@ -49,27 +45,150 @@ namespace app::game
         return m_worldHeight;
     }
 
-    auto World::get_index(u32 x, u32 y) const -> u32
+    auto World::get_tile_size() const -> f32
+    {
+        return m_tileSize;
+    }
+
+    auto World::get_index(u32 x, u32 y) const -> u64
     {
-        return x + m_worldWidth * y;
+        return x + static_cast<u64>(m_worldWidth) * y;
     }
 
-    auto World::get_coord(u32 index) const -> glm::ivec2
+    auto World::get_coord(u64 index) const -> glm::ivec2
     {
         return { index % m_worldWidth, index / m_worldWidth };
     }
 
-    bool World::is_valid_coord(const glm::uvec2 coord)
+    bool World::is_valid_coord(const glm::uvec2 coord) const
     {
         return coord.x >= 0 && coord.x < m_worldWidth && coord.y >= 0 && coord.y < m_worldHeight;
     }
 
-    auto World::get_tile(u32 x, u32 y) -> Tile&
+    auto World::get_tile(u32 x, u32 y) const -> TileType
+    {
+        ASSERT(is_valid_coord({ x, y }));
+
+        const auto* chunk = get_chunk(get_chunk_coord(x, y));
+        if (chunk == nullptr)
+        {
+            return TileType::None;
+        }
+
+        return chunk->Tiles[(x % ChunkSize) + (y % ChunkSize) * ChunkSize];
+    }
+
+    void World::set_tile(u32 x, u32 y, TileType type)
+    {
+        ASSERT(is_valid_coord({ x, y }));
+
+        const auto chunk_coord = get_chunk_coord(x, y);
+        if (type == TileType::None && get_chunk(chunk_coord) == nullptr)
+        {
+            // Already empty, don't allocate
+            return;
+        }
+
+        const glm::uvec2 local_coord = { x % ChunkSize, y % ChunkSize };
+
+        auto& chunk = allocate_chunk(chunk_coord);
+        chunk.Tiles[local_coord.x + local_coord.y * ChunkSize] = type;
+
+        mark_dirty(chunk_coord, local_coord, local_coord);
+    }
+
+    auto World::get_chunk_count() const -> u32
+    {
+        return static_cast<u32>(m_chunks.size());
+    }
+
+    auto World::get_chunk_coord(u32 x, u32 y) const -> glm::uvec2
+    {
+        return { x / ChunkSize, y / ChunkSize };
+    }
+
+    auto World::get_chunk(const glm::uvec2& chunk_coord) const -> const Chunk*
+    {
+        const auto it = m_chunks.find(get_chunk_key(chunk_coord));
+        if (it == m_chunks.end())
+        {
+            return nullptr;
+        }
+
+        return it->second.get();
+    }
+
+    auto World::get_or_create_chunk(const glm::uvec2& chunk_coord) -> Chunk&
+    {
+        mark_dirty(chunk_coord, { 0, 0 }, { ChunkSize - 1, ChunkSize - 1 });
+
+        return allocate_chunk(chunk_coord);
+    }
+
+    void World::remove_chunk(const glm::uvec2& chunk_coord)
+    {
+        if (m_chunks.erase(get_chunk_key(chunk_coord)) != 0)
+        {
+            mark_dirty(chunk_coord, { 0, 0 }, { ChunkSize - 1, ChunkSize - 1 });
+        }
+    }
+
+    void World::for_each_chunk(const std::function<void(const Chunk&)>& func) const
+    {
+        for (const auto& [key, chunk] : m_chunks)
+        {
+            func(*chunk);
+        }
+    }
+
+    auto World::get_chunk_key(const glm::uvec2& chunk_coord) -> u64
+    {
+        return (static_cast<u64>(chunk_coord.x) << 32) | chunk_coord.y;
+    }
+
+    void World::consume_dirty_regions(const std::function<void(const DirtyRegion&)>& func)
+    {
+        for (const auto& [key, region] : m_dirtyRegions)
+        {
+            func(region);
+        }
+        m_dirtyRegions.clear();
+    }
+
+    auto World::allocate_chunk(const glm::uvec2& chunk_coord) -> Chunk&
+    {
+        auto& chunk = m_chunks[get_chunk_key(chunk_coord)];
+        if (chunk == nullptr)
+        {
+            chunk = CreateOwned<Chunk>();
+            chunk->Coord = chunk_coord;
+        }
+
+        return *chunk;
+    }
+
+    void World::mark_dirty(const glm::uvec2& chunk_coord, const glm::uvec2& min, const glm::uvec2& max)
     {
-        const auto index = get_index(x, y);
-        ASSERT(index >= 0 && index < m_tiles.size());
+        auto [it, inserted] = m_dirtyRegions.try_emplace(get_chunk_key(chunk_coord));
+        auto& region = it->second;
+        if (inserted)
+        {
+            region.ChunkCoord = chunk_coord;
+            region.Min = min;
+            region.Max = max;
+            return;
+        }
 
-        return m_tiles[index];
+        region.Min = { std::min(region.Min.x, min.x), std::min(region.Min.y, min.y) };
+        region.Max = { std::max(region.Max.x, max.x), std::max(region.Max.y, max.y) };
+    }
+
+    void World::mark_all_dirty()
+    {
+        for (const auto& [key, chunk] : m_chunks)
+        {
+            mark_dirty(chunk->Coord, { 0, 0 }, { ChunkSize - 1, ChunkSize - 1 });
+        }
     }
 
 }
@@ -3,22 +3,57 @@
 #include "core/core.hpp"
 
 #include <glm/ext/vector_int2.hpp>
+#include <glm/ext/vector_uint2.hpp>
 
-#include <vector>
+#include <array>
+#include <functional>
+#include <unordered_map>
 
 namespace app::game
 {
-    struct Tile
+    /* Terrain of a single tile. Stored as one byte per tile, with the tile's coordinate implied by its index. */
+    enum class TileType : u8
     {
-        f32 Size = 1.0f;
-        glm::ivec2 Coord{};
+        None = 0,
+        Water,
+        Sand,
+        Grass,
+        Forest,
 
-        // #TODO: Temp
-        std::string SpriteName{};
+        Count
+    };
+
+    constexpr u32 TileTypeCount = static_cast<u32>(TileType::Count);
+
+    /* Name of the atlas sprite used to draw a tile type, or nullptr if the type is not drawn. */
+    auto get_tile_sprite_name(TileType type) -> const char*;
+
+    /* Tiles per chunk side. Chunks are the unit of allocation and a natural unit for rendering, generating and saving. */
+    constexpr u32 ChunkSize = 64;
+    constexpr u32 ChunkArea = ChunkSize * ChunkSize;
+
+    struct Chunk
+    {
+        glm::uvec2 Coord{};
 
-        // BaseFloorType - Original rerrain type
-        // FloorType -
-        // Object - Generated/Placed/Built object
+        // Still being generated or loaded. Drawn as a placeholder until its tiles arrive.
+        bool IsPending = false;
+
+        // Row-major, indexed by local x + local y * ChunkSize
+        std::array<TileType, ChunkArea> Tiles{};
+    };
+
+    /* Tiles of one chunk that changed, as an inclusive rectangle of local tile coordinates. */
+    struct DirtyRegion
+    {
+        glm::uvec2 ChunkCoord{};
+        glm::uvec2 Min{};
+        glm::uvec2 Max{};
+
+        bool covers_chunk() const
+        {
+            return Min.x == 0 && Min.y == 0 && Max.x == ChunkSize - 1 && Max.y == ChunkSize - 1;
+        }
     };
 
     class World
@@ -36,19 +71,56 @@ namespace app::game
 
         auto get_width() const -> u32;
         auto get_height() const -> u32;
+        auto get_tile_size() const -> f32;
+
+        auto get_index(u32 x, u32 y) const -> u64;
+        auto get_coord(u64 index) const -> glm::ivec2;
 
-        auto get_index(u32 x, u32 y) const -> u32;
-        auto get_coord(u32 index) const -> glm::ivec2;
+        bool is_valid_coord(const glm::uvec2 coord) const;
 
-        bool is_valid_coord(const glm::uvec2 coord);
+        /* Tiles in chunks that have never been written read as TileType::None. */
+        auto get_tile(u32 x, u32 y) const -> TileType;
+        void set_tile(u32 x, u32 y, TileType type);
 
-        auto get_tile(u32 x, u32 y) -> Tile&;
+        /* Chunks */
+
+        auto get_chunk_count() const -> u32;
+        auto get_chunk_coord(u32 x, u32 y) const -> glm::uvec2;
+
+        /* Returns nullptr if the chunk has not been allocated. */
+        auto get_chunk(const glm::uvec2& chunk_coord) const -> const Chunk*;
+        /* Returns the chunk for writing and marks all of it dirty. */
+        auto get_or_create_chunk(const glm::uvec2& chunk_coord) -> Chunk&;
+        void remove_chunk(const glm::uvec2& chunk_coord);
+
+        void for_each_chunk(const std::function<void(const Chunk&)>& func) const;
+
+        static auto get_chunk_key(const glm::uvec2& chunk_coord) -> u64;
+
+        /* Dirty Regions */
+
+        /**
+         * Calls func once per chunk changed since the last call, then forgets the changes.
+         * Regions of removed chunks are reported too, so cached data for them can be dropped.
+         */
+        void consume_dirty_regions(const std::function<void(const DirtyRegion&)>& func);
+
+    private:
+        auto allocate_chunk(const glm::uvec2& chunk_coord) -> Chunk&;
+
+        void mark_dirty(const glm::uvec2& chunk_coord, const glm::uvec2& min, const glm::uvec2& max);
+        void mark_all_dirty();
 
     private:
         u32 m_worldWidth = 1;
         u32 m_worldHeight = 1;
-        std::vector<Tile> m_tiles{};
+
+        // Chunks are allocated on first write
+        std::unordered_map<u64, Owned<Chunk>> m_chunks{};
+
+        // Keyed by chunk, each region grows to cover every change since it was last consumed
+        std::unordered_map<u64, DirtyRegion> m_dirtyRegions{};
 
         f32 m_tileSize = 1.0f;
     };
-}
\ No newline at end of file
+}
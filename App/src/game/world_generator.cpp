@@ -1,6 +1,7 @@
 #include "world_generator.hpp"
 
 #include "core/core.hpp"
+#include "core/job_system.hpp"
 #include "world.hpp"
 
 #include <nlohmann/json.hpp>
@@ -11,8 +12,25 @@
 
 namespace app::game
 {
-    const u32 CELL_TYPE_WATER = 0;
-    const u32 CELL_TYPE_GROUND = 1;
+    // A cell changes type once this many of its neighbours are of the other type
+    const u32 FLIP_THRESHOLD = 5;
+
+    // Rows handed to a worker at a time when stepping in parallel
+    const u32 ROWS_PER_BAND = 128;
+
+    namespace
+    {
+        /* Stateless per-cell coin flip, so any region of an unbounded world can be seeded on its own. */
+        bool hash_noise(u64 seed, i64 x, i64 y)
+        {
+            // SplitMix64 finaliser over the seed and coordinate
+            u64 h = seed ^ (static_cast<u64>(x) * 0x9E3779B97F4A7C15ull) ^ (static_cast<u64>(y) * 0xC2B2AE3D27D4EB4Full);
+            h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+            h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+            h = h ^ (h >> 31);
+            return (h >> 63) != 0;
+        }
+    }
 
     void WorldGenerator::set_world(World& world)
     {
@@ -21,31 +39,24 @@ namespace app::game
         reset();
     }
 
+    void WorldGenerator::set_job_system(core::JobSystem* job_system)
+    {
+        m_jobSystem = job_system;
+    }
+
     void WorldGenerator::reset()
     {
-        std::mt19937 gen(1998);
+        std::mt19937 gen(static_cast<u32>(m_seed));
         std::uniform_real_distribution<> dist(0.0, 1.0);
 
-        m_cells.resize(m_world->get_width() * m_world->get_height());
-        for (u32 i = 0; i < m_cells.size(); ++i)
+        m_cells.resize(m_world->get_width(), m_world->get_height());
+        m_nextCells.resize(m_world->get_width(), m_world->get_height());
+        for (u64 i = 0; i < m_cells.get_cell_count(); ++i)
         {
-            auto& cell = m_cells[i];
-            cell.Coord = m_world->get_coord(i);
-            cell.Type = dist(gen) > 0.5f ? CELL_TYPE_GROUND : CELL_TYPE_WATER;
+            m_cells.set(i, dist(gen) > 0.5f);
         }
 
-        for (const auto& cell : m_cells)
-        {
-            auto& world_tile = m_world->get_tile(cell.Coord.x, cell.Coord.y);
-            if (cell.Type == CELL_TYPE_WATER)
-            {
-                world_tile.SpriteName = "water_0";
-            }
-            else if (cell.Type == CELL_TYPE_GROUND)
-            {
-                world_tile.SpriteName = "grass_0";
-            }
-        }
+        write_world();
     }
 
     void WorldGenerator::generate(u32 steps)
@@ -54,78 +65,130 @@ namespace app::game
 
         for (u32 i = 0; i < steps; ++i)
         {
-            step();
+            step_cells();
         }
+
+        write_world();
     }
 
     void WorldGenerator::step()
     {
-        const std::vector<Cell> temp_cells = m_cells;
-        for (i32 y = 0; y < static_cast<i32>(m_world->get_height()); ++y)
+        step_cells();
+
+        write_world();
+    }
+
+    void WorldGenerator::generate_chunk(const glm::uvec2& chunk_coord, u32 steps, std::array<TileType, ChunkArea>& out_tiles) const
+    {
+        // A step only moves information one cell, so a border `steps` cells wide around the chunk absorbs
+        // every edge effect and the result matches its neighbours exactly.
+        const u32 border = steps;
+        const u32 size = ChunkSize + border * 2;
+        const i64 origin_x = static_cast<i64>(chunk_coord.x) * ChunkSize - border;
+        const i64 origin_y = static_cast<i64>(chunk_coord.y) * ChunkSize - border;
+
+        BitGrid cells{};
+        BitGrid next_cells{};
+        cells.resize(size, size);
+        next_cells.resize(size, size);
+
+        for (u32 y = 0; y < size; ++y)
         {
-            for (i32 x = 0; x < static_cast<i32>(m_world->get_width()); ++x)
+            for (u32 x = 0; x < size; ++x)
             {
-                const auto cell_index = m_world->get_index(x, y);
-
-                const bool is_cell_water = temp_cells[cell_index].Type == CELL_TYPE_WATER;
-                const bool is_cell_ground = temp_cells[cell_index].Type == CELL_TYPE_GROUND;
-                if (is_cell_ground)
-                {
-                    const u32 water_count = count_neighbours_of_type(temp_cells, x, y, CELL_TYPE_WATER, CELL_TYPE_GROUND);
-                    if (water_count >= 5)
-                    {
-                        m_cells[cell_index].Type = CELL_TYPE_WATER;
-                    }
-                }
-                else if (is_cell_water)
-                {
-                    const u32 ground_count = count_neighbours_of_type(temp_cells, x, y, CELL_TYPE_GROUND, CELL_TYPE_WATER);
-                    if (ground_count >= 5)
-                    {
-                        m_cells[cell_index].Type = CELL_TYPE_GROUND;
-                    }
-                }
+                cells.set(static_cast<u64>(y) * size + x, hash_noise(m_seed, origin_x + x, origin_y + y));
             }
         }
 
-        m_world->clear();
-        for (const auto& cell : m_cells)
+        for (u32 i = 0; i < steps; ++i)
         {
-            auto& world_tile = m_world->get_tile(cell.Coord.x, cell.Coord.y);
-            if (cell.Type == 0)
-            {
-                world_tile.SpriteName = "water_0";
-            }
-            else if (cell.Type == 1)
+            step_automaton(cells, next_cells, 0, cells.get_word_count(), FLIP_THRESHOLD);
+            std::swap(cells, next_cells);
+        }
+
+        for (u32 y = 0; y < ChunkSize; ++y)
+        {
+            for (u32 x = 0; x < ChunkSize; ++x)
             {
-                world_tile.SpriteName = "grass_0";
+                const bool is_ground = cells.get(static_cast<u64>(y + border) * size + x + border);
+                out_tiles[x + y * ChunkSize] = is_ground ? TileType::Grass : TileType::Water;
             }
         }
     }
 
-    auto WorldGenerator::count_neighbours_of_type(const std::vector<Cell>& cells, i32 x, i32 y, u32 type_to_count, u32 out_of_bounds_type)
-        -> u32
+    void WorldGenerator::step_cells()
     {
-        u32 count = 0;
-        for (i32 ny = y - 1; ny <= y + 1; ++ny)
+        const u32 word_count = m_cells.get_word_count();
+        if (m_jobSystem == nullptr)
         {
-            for (i32 nx = x - 1; nx <= x + 1; ++nx)
+            step_automaton(m_cells, m_nextCells, 0, word_count, FLIP_THRESHOLD);
+        }
+        else
+        {
+            // Each band writes only its own words of m_nextCells, so the result matches the serial path bit for bit
+            const u64 width = m_cells.get_width();
+            const u32 band_count = (m_cells.get_height() + ROWS_PER_BAND - 1) / ROWS_PER_BAND;
+            auto band_start_word = [&](u32 band) -> u32
             {
-                auto n_index = m_world->get_index(nx, ny);
-
-                u32 cell_type = out_of_bounds_type;
-                if (n_index >= 0 && n_index < cells.size())
+                if (band >= band_count)
                 {
-                    cell_type = cells[n_index].Type;
+                    return word_count;
                 }
+                return static_cast<u32>(static_cast<u64>(band) * ROWS_PER_BAND * width / 64);
+            };
+
+            m_jobSystem->parallel_for(band_count,
+                                      1,
+                                      [&](u32 begin, u32 end)
+                                      {
+                                          step_automaton(m_cells, m_nextCells, band_start_word(begin), band_start_word(end), FLIP_THRESHOLD);
+                                      });
+        }
+
+        // Ping-pong between the two preallocated grids
+        std::swap(m_cells, m_nextCells);
+    }
+
+    void WorldGenerator::write_world()
+    {
+        const u32 width = m_world->get_width();
+        const u32 height = m_world->get_height();
 
-                if (cell_type == type_to_count)
+        // Allocate the chunks up front, then fill them independently
+        std::vector<Chunk*> chunks{};
+        for (u32 cy = 0; cy * ChunkSize < height; ++cy)
+        {
+            for (u32 cx = 0; cx * ChunkSize < width; ++cx)
+            {
+                chunks.push_back(&m_world->get_or_create_chunk({ cx, cy }));
+            }
+        }
+
+        auto write_chunks = [&](u32 begin, u32 end)
+        {
+            for (u32 i = begin; i < end; ++i)
+            {
+                auto& chunk = *chunks[i];
+                const glm::uvec2 origin = chunk.Coord * ChunkSize;
+                for (u32 ly = 0; ly < ChunkSize && origin.y + ly < height; ++ly)
                 {
-                    ++count;
+                    for (u32 lx = 0; lx < ChunkSize && origin.x + lx < width; ++lx)
+                    {
+                        const bool is_ground = m_cells.get(m_world->get_index(origin.x + lx, origin.y + ly));
+                        chunk.Tiles[lx + ly * ChunkSize] = is_ground ? TileType::Grass : TileType::Water;
+                    }
                 }
             }
+        };
+
+        if (m_jobSystem == nullptr)
+        {
+            write_chunks(0, static_cast<u32>(chunks.size()));
+        }
+        else
+        {
+            m_jobSystem->parallel_for(static_cast<u32>(chunks.size()), 4, write_chunks);
         }
-        return count;
     }
 
 }
\ No newline at end of file
@@ -2,15 +2,20 @@
 
 #include "core/core.hpp"
 #include "perlin_noise.hpp"
+#include "bit_grid.hpp"
+#include "world.hpp"
 
 #include <vector>
 #include <string>
 #include <random>
 
-namespace app::game
+namespace app::core
 {
-    class World;
+    class JobSystem;
+}
 
+namespace app::game
+{
     class WorldGenerator
     {
     public:
@@ -19,25 +24,32 @@ namespace app::game
 
         void set_world(World& world);
 
+        /* Steps are split into row bands across the job system's workers. Pass nullptr to step serially. */
+        void set_job_system(core::JobSystem* job_system);
+
         void reset();
 
         void generate(u32 steps);
         void step();
 
-    private:
-        struct Cell;
+        /**
+         * Generates a single chunk from hashed noise, independent of the world size and of any other chunk.
+         * Does not touch the generator's own state, so it is safe to call from worker threads.
+         */
+        void generate_chunk(const glm::uvec2& chunk_coord, u32 steps, std::array<TileType, ChunkArea>& out_tiles) const;
 
-        auto count_neighbours_of_type(const std::vector<Cell>& cells, i32 x, i32 y, u32 type_to_count, u32 out_of_bounds_type) -> u32;
+    private:
+        void step_cells();
+        void write_world();
 
     private:
         World* m_world = nullptr;
+        core::JobSystem* m_jobSystem = nullptr;
+        u64 m_seed = 1998;
         siv::PerlinNoise m_noise{};
 
-        struct Cell
-        {
-            glm::ivec2 Coord{};
-            i32 Type = -1;
-        };
-        std::vector<Cell> m_cells{};
+        // One bit per cell, set for ground. Stepped into m_nextCells and then swapped.
+        BitGrid m_cells{};
+        BitGrid m_nextCells{};
     };
 }
\ No newline at end of file
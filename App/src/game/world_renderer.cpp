@@ -1,12 +1,32 @@
 #include "world_renderer.hpp"
 
-#include "world.hpp"
 #include "rendering/renderer.hpp"
 #include "rendering/shader.hpp"
 #include "rendering/buffer.hpp"
+#include "rendering/buffer_pool.hpp"
+#include "rendering/texture.hpp"
+#include "core/job_system.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/ext/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cstring>
 
 namespace app::game
 {
+    // Covers chunks that are still being generated
+    const char* PLACEHOLDER_SPRITE = "sand_0";
+
+    // Chunk meshes and textures that have not been on screen for this many frames are released
+    constexpr u64 CHUNK_RETAIN_FRAMES = 300;
+
+    // Sprite index of pending chunks, the placeholder sprite follows the tile types in the sprite UV table
+    constexpr u8 PLACEHOLDER_SPRITE_INDEX = static_cast<u8>(TileTypeCount);
+
+    // Chunk buffer pool blocks, enough for 64 full chunk meshes
+    constexpr sizet CHUNK_POOL_BLOCK_SIZE = 16 * 1024 * 1024;
+
     void WorldRenderer::init(gfx::Renderer& renderer)
     {
         m_renderer = &renderer;
@@ -14,10 +34,80 @@ namespace app::game
         m_shader = renderer.create_shader();
         m_shader->init("../../assets/shaders/default.vert.spv", "../../assets/shaders/default.frag.spv");
 
+        gfx::ShaderInfo tilemap_info{};
+        tilemap_info.VertexFile = "../../assets/shaders/tilemap.vert.spv";
+        tilemap_info.FragmentFile = "../../assets/shaders/tilemap.frag.spv";
+        tilemap_info.VertexAttributes = {};
+        tilemap_info.TextureSetCount = 3;  // Atlas, sprite UVs, chunk tiles
+        m_tilemapShader = renderer.create_shader();
+        m_tilemapShader->init(tilemap_info);
+
+        gfx::ShaderInfo instanced_info{};
+        instanced_info.VertexFile = "../../assets/shaders/tile_instanced.vert.spv";
+        instanced_info.FragmentFile = "../../assets/shaders/default.frag.spv";
+        instanced_info.VertexAttributes = { vk::Format::eR8G8B8A8Uint };
+        instanced_info.VertexInputRate = vk::VertexInputRate::eInstance;
+        instanced_info.TextureSetCount = 2;  // Atlas, sprite UVs
+        m_instancedShader = renderer.create_shader();
+        m_instancedShader->init(instanced_info);
+
+        gfx::ShaderInfo greedy_info{};
+        greedy_info.VertexFile = "../../assets/shaders/tile_greedy.vert.spv";
+        greedy_info.FragmentFile = "../../assets/shaders/tile_greedy.frag.spv";
+        greedy_info.VertexAttributes = { vk::Format::eR8G8B8A8Uint };
+        greedy_info.TextureSetCount = 2;  // Atlas, sprite UVs
+        m_greedyShader = renderer.create_shader();
+        m_greedyShader->init(greedy_info);
+
+        gfx::ShaderInfo impostor_info{};
+        impostor_info.VertexFile = "../../assets/shaders/tilemap.vert.spv";
+        impostor_info.FragmentFile = "../../assets/shaders/impostor.frag.spv";
+        impostor_info.VertexAttributes = {};
+        impostor_info.TextureSetCount = 1;  // Chunk impostor
+        m_impostorShader = renderer.create_shader();
+        m_impostorShader->init(impostor_info);
+
         m_atlas.init(m_renderer, "../../assets/textures/tileset.json");
 
-        m_vertexBuffer = m_renderer->create_buffer();
+        for (u32 i = 0; i < TileTypeCount; ++i)
+        {
+            const auto* sprite_name = get_tile_sprite_name(static_cast<TileType>(i));
+            m_tileSprites[i] = sprite_name != nullptr ? &m_atlas.get_sprite(sprite_name) : nullptr;
+        }
+        m_placeholderSprite = &m_atlas.get_sprite(PLACEHOLDER_SPRITE);
+
+        std::array<glm::vec4, TileTypeCount + 1> sprite_uvs{};
+        for (u32 i = 0; i < TileTypeCount; ++i)
+        {
+            if (m_tileSprites[i] != nullptr)
+            {
+                sprite_uvs[i] = { m_tileSprites[i]->MinUV, m_tileSprites[i]->MaxUV };
+            }
+        }
+        sprite_uvs[PLACEHOLDER_SPRITE_INDEX] = { m_placeholderSprite->MinUV, m_placeholderSprite->MaxUV };
+
+        m_spriteUVTexture = m_renderer->create_texture();
+        m_spriteUVTexture->init(static_cast<u32>(sprite_uvs.size()), 1, vk::Format::eR32G32B32A32Sfloat, sprite_uvs.data());
+
+        // Every chunk mesh lays its quads out the same way, so one index buffer serves them all
+        std::vector<u32> indices{};
+        indices.reserve(ChunkArea * 6);
+        for (u32 quad = 0; quad < ChunkArea; ++quad)
+        {
+            const u32 first = quad * 4;
+            indices.insert(indices.end(), { first, first + 1, first + 2, first + 2, first + 3, first });
+        }
+
+        m_meshPool = m_renderer->create_buffer_pool();
+        m_meshPool->init(sizeof(Vertex), CHUNK_POOL_BLOCK_SIZE, vk::BufferUsageFlagBits::eVertexBuffer);
+        m_instancePool = m_renderer->create_buffer_pool();
+        m_instancePool->init(sizeof(TileInstance), CHUNK_POOL_BLOCK_SIZE, vk::BufferUsageFlagBits::eVertexBuffer);
+        m_greedyPool = m_renderer->create_buffer_pool();
+        m_greedyPool->init(sizeof(GreedyVertex), CHUNK_POOL_BLOCK_SIZE, vk::BufferUsageFlagBits::eVertexBuffer);
+
         m_indexBuffer = m_renderer->create_buffer();
+        m_indexBuffer->init(sizeof(u32) * indices.size(), vk::BufferUsageFlagBits::eIndexBuffer);
+        m_indexBuffer->write_data(0, sizeof(u32) * indices.size(), indices.data());
     }
 
     void WorldRenderer::set_world(World& world)
@@ -27,6 +117,27 @@ namespace app::game
         force_rebuild();
     }
 
+    void WorldRenderer::set_job_system(core::JobSystem* job_system)
+    {
+        m_jobSystem = job_system;
+    }
+
+    void WorldRenderer::set_render_mode(WorldRenderMode mode)
+    {
+        if (mode == m_renderMode)
+        {
+            return;
+        }
+
+        m_renderMode = mode;
+        force_rebuild();
+    }
+
+    void WorldRenderer::set_lod_threshold(f32 pixels_per_tile)
+    {
+        m_lodThreshold = pixels_per_tile;
+    }
+
     void WorldRenderer::force_rebuild()
     {
         m_isDirty = true;
@@ -36,92 +147,688 @@ namespace app::game
     {
         if (m_isDirty)
         {
-            rebuild_mesh();
+            m_chunkData.clear();
+            m_isDirty = false;
+        }
+
+        apply_dirty_regions();
+
+        ++m_frame;
+        m_drawnChunkCount = 0;
+        m_drawnQuadCount = 0;
+
+        // Chunk range overlapping the view, clamped to the world
+        const f32 chunk_extent = m_world->get_tile_size() * ChunkSize;
+        const glm::vec2 view_min = m_renderer->get_view_min() / chunk_extent;
+        const glm::vec2 view_max = m_renderer->get_view_max() / chunk_extent;
+        const i32 max_chunk_x = static_cast<i32>((m_world->get_width() - 1) / ChunkSize);
+        const i32 max_chunk_y = static_cast<i32>((m_world->get_height() - 1) / ChunkSize);
+        const i32 min_x = glm::clamp(static_cast<i32>(glm::floor(view_min.x)), 0, max_chunk_x);
+        const i32 min_y = glm::clamp(static_cast<i32>(glm::floor(view_min.y)), 0, max_chunk_y);
+        const i32 max_x = glm::clamp(static_cast<i32>(glm::floor(view_max.x)), 0, max_chunk_x);
+        const i32 max_y = glm::clamp(static_cast<i32>(glm::floor(view_max.y)), 0, max_chunk_y);
+
+        const f32 pixels_per_tile = m_renderer->get_viewport_size().y / (view_max.y - view_min.y) / ChunkSize;
+        m_isUsingImpostors = pixels_per_tile < m_lodThreshold;
+
+        m_visibleChunks.clear();
+        for (i32 y = min_y; y <= max_y; ++y)
+        {
+            for (i32 x = min_x; x <= max_x; ++x)
+            {
+                const glm::uvec2 coord{ static_cast<u32>(x), static_cast<u32>(y) };
+
+                const auto* chunk = m_world->get_chunk(coord);
+                if (chunk == nullptr)
+                {
+                    continue;
+                }
+
+                auto& data = m_chunkData[World::get_chunk_key(coord)];
+                if (m_isUsingImpostors)
+                {
+                    if (data.TileImpostor == nullptr)
+                    {
+                        build_chunk_impostor(*chunk, data);
+                    }
+                }
+                else if (!data.IsBuilt)
+                {
+                    // Marked now so a chunk is queued once, the build itself happens in flush_builds()
+                    data.IsBuilt = true;
+                    m_pendingBuilds.push_back({ chunk, &data });
+                }
+                data.LastDrawnFrame = m_frame;
+
+                m_visibleChunks.push_back({ chunk, &data });
+            }
+        }
+
+        flush_builds();
+
+        if (m_isUsingImpostors)
+        {
+            m_renderer->bind_shader(m_impostorShader.get());
+            for (const auto& visible : m_visibleChunks)
+            {
+                draw_chunk_impostor(*visible.Source, *visible.Data);
+            }
+
+            m_culledChunkCount = m_world->get_chunk_count() - m_drawnChunkCount;
+
+            release_unused_chunks();
+            return;
         }
 
-        m_renderer->bind_shader(m_shader.get());
-        m_renderer->bind_texture(m_shader.get(), m_atlas.get_texture());
+        switch (m_renderMode)
+        {
+            case WorldRenderMode::Meshes:
+            {
+                m_renderer->bind_shader(m_shader.get());
+                m_renderer->bind_texture(m_shader.get(), m_atlas.get_texture());
+                break;
+            }
+            case WorldRenderMode::Instanced:
+            {
+                m_renderer->bind_shader(m_instancedShader.get());
+                m_renderer->bind_texture(m_instancedShader.get(), m_atlas.get_texture(), 0);
+                m_renderer->bind_texture(m_instancedShader.get(), m_spriteUVTexture.get(), 1);
+                break;
+            }
+            case WorldRenderMode::Tilemap:
+            {
+                m_renderer->bind_shader(m_tilemapShader.get());
+                m_renderer->bind_texture(m_tilemapShader.get(), m_atlas.get_texture(), 0);
+                m_renderer->bind_texture(m_tilemapShader.get(), m_spriteUVTexture.get(), 1);
+                break;
+            }
+            case WorldRenderMode::Greedy:
+            {
+                m_renderer->bind_shader(m_greedyShader.get());
+                m_renderer->bind_texture(m_greedyShader.get(), m_atlas.get_texture(), 0);
+                m_renderer->bind_texture(m_greedyShader.get(), m_spriteUVTexture.get(), 1);
+                break;
+            }
+        }
 
-        m_renderer->draw_indexed(m_vertexBuffer.get(), m_indexBuffer.get(), m_indexCount);
+        for (const auto& visible : m_visibleChunks)
+        {
+            draw_chunk(*visible.Source, *visible.Data);
+        }
+
+        m_culledChunkCount = m_world->get_chunk_count() - m_drawnChunkCount;
+
+        release_unused_chunks();
+    }
+
+    auto WorldRenderer::get_render_mode() const -> WorldRenderMode
+    {
+        return m_renderMode;
+    }
+
+    auto WorldRenderer::get_lod_threshold() const -> f32
+    {
+        return m_lodThreshold;
+    }
+
+    bool WorldRenderer::is_using_impostors() const
+    {
+        return m_isUsingImpostors;
     }
 
     auto WorldRenderer::get_vertex_count() const -> u32
     {
-        return static_cast<u32>(m_vertices.size());
+        return m_drawnQuadCount * 4;
     }
 
     auto WorldRenderer::get_triangle_count() const -> u32
     {
-        return static_cast<u32>(m_indices.size() / 3);
+        return m_drawnQuadCount * 2;
+    }
+
+    auto WorldRenderer::get_drawn_chunk_count() const -> u32
+    {
+        return m_drawnChunkCount;
+    }
+
+    auto WorldRenderer::get_culled_chunk_count() const -> u32
+    {
+        return m_culledChunkCount;
     }
 
-    void WorldRenderer::rebuild_mesh()
+    auto WorldRenderer::get_gpu_memory_usage() const -> sizet
     {
-        m_vertices.clear();
-        m_indices.clear();
-        m_indexCount = 0;
+        sizet bytes = 0;
+        for (const auto& [key, data] : m_chunkData)
+        {
+            bytes += data.VertexBuffer != nullptr ? data.VertexBuffer->get_size() : 0;
+            bytes += data.InstanceBuffer != nullptr ? data.InstanceBuffer->get_size() : 0;
+            bytes += data.TileTexture != nullptr ? ChunkArea : 0;
+            bytes += data.TileImpostor != nullptr ? ChunkArea * sizeof(glm::u8vec4) : 0;
+        }
+
+        return bytes;
+    }
 
-        for (u32 y = 0; y < m_world->get_height(); ++y)
+    void WorldRenderer::apply_dirty_regions()
+    {
+        const auto apply_region = [&](const DirtyRegion& region)
         {
-            for (u32 x = 0; x < m_world->get_width(); ++x)
+            const auto key = World::get_chunk_key(region.ChunkCoord);
+            auto it = m_chunkData.find(key);
+            if (it == m_chunkData.end())
             {
-                const auto& tile = m_world->get_tile(x, y);
-                const auto position = glm::vec2(tile.Coord) * tile.Size;
+                // Not cached, built from scratch when it comes into view
+                return;
+            }
 
-                if (tile.SpriteName.empty())
+            const auto* chunk = m_world->get_chunk(region.ChunkCoord);
+            if (chunk == nullptr)
+            {
+                m_chunkData.erase(it);
+                return;
+            }
+
+            // Edits go out with the frame, so data still streaming in has to land first. Waiting for it would stall the frame
+            // behind the transfer queue, so the edit is held until a later frame instead.
+            auto& data = it->second;
+            if (!m_renderer->is_upload_ready(data.Upload))
+            {
+                auto [deferred_it, inserted] = m_deferredRegions.try_emplace(key, region);
+                auto& deferred = deferred_it->second;
+                if (!inserted)
+                {
+                    deferred.Min = glm::min(deferred.Min, region.Min);
+                    deferred.Max = glm::max(deferred.Max, region.Max);
+                }
+                return;
+            }
+
+            if (data.TileImpostor != nullptr)
+            {
+                update_chunk_impostor(*chunk, data, region);
+            }
+
+            if (!data.IsBuilt)
+            {
+                return;
+            }
+
+            // Greedy quads span many tiles, so any change remeshes the whole chunk
+            if (region.covers_chunk() || data.IsPlaceholder || chunk->IsPending || m_renderMode == WorldRenderMode::Greedy)
+            {
+                m_pendingBuilds.push_back({ chunk, &data });
+                return;
+            }
+
+            switch (m_renderMode)
+            {
+                case WorldRenderMode::Meshes: update_chunk_mesh(*chunk, data, region); break;
+                case WorldRenderMode::Instanced: update_chunk_instances(*chunk, data, region); break;
+                case WorldRenderMode::Tilemap: update_chunk_tilemap(*chunk, data, region); break;
+                case WorldRenderMode::Greedy: break;
+            }
+        };
+
+        // Held edits go first, newer edits to a chunk still streaming in are merged into them again
+        auto deferred_regions = std::move(m_deferredRegions);
+        m_deferredRegions.clear();
+        for (const auto& [key, region] : deferred_regions)
+        {
+            apply_region(region);
+        }
+
+        m_world->consume_dirty_regions(apply_region);
+    }
+
+    void WorldRenderer::release_unused_chunks()
+    {
+        for (auto it = m_chunkData.begin(); it != m_chunkData.end();)
+        {
+            if (m_frame - it->second.LastDrawnFrame > CHUNK_RETAIN_FRAMES)
+            {
+                it = m_chunkData.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    void WorldRenderer::flush_builds()
+    {
+        if (m_pendingBuilds.empty())
+        {
+            return;
+        }
+
+        // Chunks with nothing to draw yet stream in through one upload batch, which may overlap rendering on the transfer
+        // queue. Chunks being rebuilt are still drawn from their data, so it is replaced ahead of the frame instead.
+        const auto has_data = [this](const ChunkBuild& build)
+        {
+            switch (m_renderMode)
+            {
+                case WorldRenderMode::Meshes:
+                case WorldRenderMode::Greedy: return build.Data->VertexBuffer != nullptr;
+                case WorldRenderMode::Instanced: return build.Data->InstanceBuffer != nullptr;
+                case WorldRenderMode::Tilemap: return build.Data->TileTexture != nullptr;
+            }
+            return false;
+        };
+        const auto first_new = std::partition(m_pendingBuilds.begin(), m_pendingBuilds.end(), has_data);
+        const bool has_new_chunks = first_new != m_pendingBuilds.end();
+
+        if (m_renderMode == WorldRenderMode::Tilemap)
+        {
+            for (auto it = m_pendingBuilds.begin(); it != m_pendingBuilds.end(); ++it)
+            {
+                if (it == first_new)
+                {
+                    m_renderer->begin_upload_batch();
+                }
+                build_chunk_tilemap(*it->Source, *it->Data);
+            }
+
+            if (has_new_chunks)
+            {
+                const auto upload = m_renderer->end_upload_batch();
+                std::for_each(first_new, m_pendingBuilds.end(), [upload](const ChunkBuild& build) { build.Data->Upload = upload; });
+            }
+            m_pendingBuilds.clear();
+            return;
+        }
+
+        // Buffers are created and staging memory reserved here, workers only fill the staging memory
+        for (auto it = m_pendingBuilds.begin(); it != m_pendingBuilds.end(); ++it)
+        {
+            if (it == first_new)
+            {
+                m_renderer->begin_upload_batch();
+            }
+            it->Staging = begin_chunk_build(*it->Source, *it->Data);
+        }
+
+        const auto fill_chunks = [this](u32 begin, u32 end)
+        {
+            for (u32 i = begin; i < end; ++i)
+            {
+                const auto& build = m_pendingBuilds[i];
+                switch (m_renderMode)
+                {
+                    case WorldRenderMode::Meshes: fill_chunk_mesh(*build.Source, static_cast<Vertex*>(build.Staging)); break;
+                    case WorldRenderMode::Instanced: fill_chunk_instances(*build.Source, static_cast<TileInstance*>(build.Staging)); break;
+                    case WorldRenderMode::Greedy:
+                    {
+                        // Each build owns its chunk's data, so workers never share a write
+                        build.Data->QuadCount = fill_chunk_greedy(*build.Source, static_cast<GreedyVertex*>(build.Staging));
+                        break;
+                    }
+                    case WorldRenderMode::Tilemap: break;
+                }
+            }
+        };
+
+        const auto build_count = static_cast<u32>(m_pendingBuilds.size());
+        if (m_jobSystem != nullptr)
+        {
+            m_jobSystem->parallel_for(build_count, 1, fill_chunks);
+        }
+        else
+        {
+            fill_chunks(0, build_count);
+        }
+
+        if (has_new_chunks)
+        {
+            const auto upload = m_renderer->end_upload_batch();
+            std::for_each(first_new, m_pendingBuilds.end(), [upload](const ChunkBuild& build) { build.Data->Upload = upload; });
+        }
+        m_pendingBuilds.clear();
+    }
+
+    auto WorldRenderer::begin_chunk_build(const Chunk& chunk, ChunkRenderData& data) -> void*
+    {
+        // Every tile has a fixed slot, or at worst its own greedy quad, so buffers are allocated once per chunk
+        auto& buffer = m_renderMode == WorldRenderMode::Instanced ? data.InstanceBuffer : data.VertexBuffer;
+        if (buffer == nullptr)
+        {
+            // Device local, chunks are rewritten far less often than they are drawn
+            switch (m_renderMode)
+            {
+                case WorldRenderMode::Meshes: buffer = m_meshPool->allocate(sizeof(Vertex) * 4 * ChunkArea); break;
+                case WorldRenderMode::Instanced: buffer = m_instancePool->allocate(sizeof(TileInstance) * ChunkArea); break;
+                case WorldRenderMode::Greedy: buffer = m_greedyPool->allocate(sizeof(GreedyVertex) * 4 * ChunkArea); break;
+                case WorldRenderMode::Tilemap: break;
+            }
+        }
+
+        data.IsPlaceholder = chunk.IsPending;
+        data.QuadCount = chunk.IsPending ? 1 : ChunkArea;
+
+        return buffer->stage_write(0, buffer->get_size());
+    }
+
+    void WorldRenderer::draw_chunk(const Chunk& chunk, const ChunkRenderData& data)
+    {
+        if (!m_renderer->is_upload_ready(data.Upload))
+        {
+            return;
+        }
+
+        const f32 tile_size = m_world->get_tile_size();
+        const glm::vec2 origin = glm::vec2(chunk.Coord * ChunkSize) * tile_size;
+
+        switch (m_renderMode)
+        {
+            case WorldRenderMode::Meshes:
+            {
+                m_renderer->draw_indexed(data.VertexBuffer.get(), m_indexBuffer.get(), data.QuadCount * 6);
+                m_drawnQuadCount += data.QuadCount;
+                break;
+            }
+            case WorldRenderMode::Instanced:
+            {
+                // Instances are in local tile units
+                glm::mat4 push_data[2];
+                push_data[0] = m_renderer->get_view_projection();
+                push_data[1] = glm::scale(glm::translate(glm::mat4(1.0f), { origin, 0.0f }), { tile_size, tile_size, 1.0f });
+                m_renderer->set_push_constants(m_instancedShader.get(), sizeof(push_data), push_data);
+
+                m_renderer->draw_instanced(data.InstanceBuffer.get(), 6, data.QuadCount);
+                m_drawnQuadCount += data.QuadCount;
+                break;
+            }
+            case WorldRenderMode::Tilemap:
+            {
+                // Unit quad scaled over the chunk, tiles are resolved per pixel
+                const f32 chunk_extent = tile_size * ChunkSize;
+
+                glm::mat4 push_data[2];
+                push_data[0] = m_renderer->get_view_projection();
+                push_data[1] = glm::scale(glm::translate(glm::mat4(1.0f), { origin, 0.0f }), { chunk_extent, chunk_extent, 1.0f });
+                m_renderer->set_push_constants(m_tilemapShader.get(), sizeof(push_data), push_data);
+
+                m_renderer->bind_texture(m_tilemapShader.get(), data.TileTexture.get(), 2);
+                m_renderer->draw(6);
+                ++m_drawnQuadCount;
+                break;
+            }
+            case WorldRenderMode::Greedy:
+            {
+                // Vertices are in local tile units
+                glm::mat4 push_data[2];
+                push_data[0] = m_renderer->get_view_projection();
+                push_data[1] = glm::scale(glm::translate(glm::mat4(1.0f), { origin, 0.0f }), { tile_size, tile_size, 1.0f });
+                m_renderer->set_push_constants(m_greedyShader.get(), sizeof(push_data), push_data);
+
+                m_renderer->draw_indexed(data.VertexBuffer.get(), m_indexBuffer.get(), data.QuadCount * 6);
+                m_drawnQuadCount += data.QuadCount;
+                break;
+            }
+        }
+
+        ++m_drawnChunkCount;
+    }
+
+    void WorldRenderer::fill_chunk_mesh(const Chunk& chunk, Vertex* out) const
+    {
+        if (chunk.IsPending)
+        {
+            const f32 tile_size = m_world->get_tile_size();
+            const auto min = glm::vec2(chunk.Coord * ChunkSize) * tile_size;
+            const auto max = min + tile_size * ChunkSize;
+            const auto* sprite = m_placeholderSprite;
+
+            out[0] = { { min.x, min.y }, { sprite->MinUV.x, sprite->MinUV.y } };
+            out[1] = { { max.x, min.y }, { sprite->MaxUV.x, sprite->MinUV.y } };
+            out[2] = { { max.x, max.y }, { sprite->MaxUV.x, sprite->MaxUV.y } };
+            out[3] = { { min.x, max.y }, { sprite->MinUV.x, sprite->MaxUV.y } };
+            return;
+        }
+
+        for (u32 ly = 0; ly < ChunkSize; ++ly)
+        {
+            write_tile_quads(chunk, 0, ChunkSize - 1, ly, out + 4 * ly * ChunkSize);
+        }
+    }
+
+    void WorldRenderer::update_chunk_mesh(const Chunk& chunk, ChunkRenderData& data, const DirtyRegion& region)
+    {
+        // One copy per row, as the region's rows are not contiguous in the buffer
+        const u32 row_tiles = region.Max.x - region.Min.x + 1;
+        for (u32 ly = region.Min.y; ly <= region.Max.y; ++ly)
+        {
+            const sizet offset = sizeof(Vertex) * 4 * (region.Min.x + ly * ChunkSize);
+            auto* vertices = static_cast<Vertex*>(data.VertexBuffer->stage_write(offset, sizeof(Vertex) * 4 * row_tiles));
+            write_tile_quads(chunk, region.Min.x, region.Max.x, ly, vertices);
+        }
+    }
+
+    void WorldRenderer::write_tile_quads(const Chunk& chunk, u32 first_x, u32 last_x, u32 y, Vertex* out) const
+    {
+        // Output may be write-combined staging memory, so every vertex is written once and never read back
+        const f32 tile_size = m_world->get_tile_size();
+        const glm::uvec2 origin = chunk.Coord * ChunkSize;
+        for (u32 x = first_x; x <= last_x; ++x, out += 4)
+        {
+            const auto* sprite = m_tileSprites[static_cast<u32>(chunk.Tiles[x + y * ChunkSize])];
+            if (sprite == nullptr)
+            {
+                // Degenerate quad keeps the slot without drawing anything
+                const Vertex empty{};
+                out[0] = empty;
+                out[1] = empty;
+                out[2] = empty;
+                out[3] = empty;
+                continue;
+            }
+
+            const auto min = glm::vec2(origin.x + x, origin.y + y) * tile_size;
+            const auto max = min + tile_size;
+
+            out[0] = { { min.x, min.y }, { sprite->MinUV.x, sprite->MinUV.y } };
+            out[1] = { { max.x, min.y }, { sprite->MaxUV.x, sprite->MinUV.y } };
+            out[2] = { { max.x, max.y }, { sprite->MaxUV.x, sprite->MaxUV.y } };
+            out[3] = { { min.x, max.y }, { sprite->MinUV.x, sprite->MaxUV.y } };
+        }
+    }
+
+    void WorldRenderer::fill_chunk_instances(const Chunk& chunk, TileInstance* out) const
+    {
+        if (chunk.IsPending)
+        {
+            *out = { 0, 0, PLACEHOLDER_SPRITE_INDEX, static_cast<u8>(ChunkSize) };
+            return;
+        }
+
+        for (u32 ly = 0; ly < ChunkSize; ++ly)
+        {
+            write_tile_instances(chunk, 0, ChunkSize - 1, ly, out + ly * ChunkSize);
+        }
+    }
+
+    void WorldRenderer::update_chunk_instances(const Chunk& chunk, ChunkRenderData& data, const DirtyRegion& region)
+    {
+        const u32 row_tiles = region.Max.x - region.Min.x + 1;
+        for (u32 ly = region.Min.y; ly <= region.Max.y; ++ly)
+        {
+            const sizet offset = sizeof(TileInstance) * (region.Min.x + ly * ChunkSize);
+            auto* instances = static_cast<TileInstance*>(data.InstanceBuffer->stage_write(offset, sizeof(TileInstance) * row_tiles));
+            write_tile_instances(chunk, region.Min.x, region.Max.x, ly, instances);
+        }
+    }
+
+    void WorldRenderer::write_tile_instances(const Chunk& chunk, u32 first_x, u32 last_x, u32 y, TileInstance* out) const
+    {
+        for (u32 x = first_x; x <= last_x; ++x, ++out)
+        {
+            const auto type = static_cast<u8>(chunk.Tiles[x + y * ChunkSize]);
+
+            // Empty tiles get a zero size, which collapses the quad
+            const u8 size = m_tileSprites[type] != nullptr ? 1 : 0;
+            *out = { static_cast<u8>(x), static_cast<u8>(y), type, size };
+        }
+    }
+
+    auto WorldRenderer::fill_chunk_greedy(const Chunk& chunk, GreedyVertex* out) const -> u32
+    {
+        const auto write_quad = [&out](u32 min_x, u32 min_y, u32 max_x, u32 max_y, u8 sprite)
+        {
+            out[0] = { static_cast<u8>(min_x), static_cast<u8>(min_y), sprite, 0 };
+            out[1] = { static_cast<u8>(max_x), static_cast<u8>(min_y), sprite, 0 };
+            out[2] = { static_cast<u8>(max_x), static_cast<u8>(max_y), sprite, 0 };
+            out[3] = { static_cast<u8>(min_x), static_cast<u8>(max_y), sprite, 0 };
+            out += 4;
+        };
+
+        if (chunk.IsPending)
+        {
+            write_quad(0, 0, ChunkSize, ChunkSize, PLACEHOLDER_SPRITE_INDEX);
+            return 1;
+        }
+
+        // Grow each unvisited tile into the widest run of its type, then down while whole rows match
+        std::array<bool, ChunkArea> visited{};
+        u32 quad_count = 0;
+        for (u32 y = 0; y < ChunkSize; ++y)
+        {
+            for (u32 x = 0; x < ChunkSize; ++x)
+            {
+                const auto type = chunk.Tiles[x + y * ChunkSize];
+                if (visited[x + y * ChunkSize] || m_tileSprites[static_cast<u32>(type)] == nullptr)
+                {
                     continue;
+                }
+
+                u32 width = 1;
+                while (x + width < ChunkSize && !visited[x + width + y * ChunkSize] && chunk.Tiles[x + width + y * ChunkSize] == type)
+                {
+                    ++width;
+                }
+
+                u32 height = 1;
+                for (; y + height < ChunkSize; ++height)
+                {
+                    const u32 row = (y + height) * ChunkSize;
 
-                const auto& sprite = m_atlas.get_sprite(tile.SpriteName);
-                const glm::vec2 uv = { sprite.x, sprite.y };
+                    bool row_matches = true;
+                    for (u32 rx = x; rx < x + width && row_matches; ++rx)
+                    {
+                        row_matches = !visited[rx + row] && chunk.Tiles[rx + row] == type;
+                    }
 
-                auto v1 = add_vertex({ position.x, position.y }, { sprite.MinUV.x, sprite.MinUV.y });
-                auto v2 = add_vertex({ position.x + tile.Size, position.y }, { sprite.MaxUV.x, sprite.MinUV.y });
-                auto v3 = add_vertex({ position.x + tile.Size, position.y + tile.Size }, { sprite.MaxUV.x, sprite.MaxUV.y });
-                auto v4 = add_vertex({ position.x, position.y + tile.Size }, { sprite.MinUV.x, sprite.MaxUV.y });
+                    if (!row_matches)
+                    {
+                        break;
+                    }
+                }
 
-                add_quad(v1, v2, v3, v4);
+                for (u32 ry = y; ry < y + height; ++ry)
+                {
+                    std::fill_n(visited.begin() + x + ry * ChunkSize, width, true);
+                }
+
+                write_quad(x, y, x + width, y + height, static_cast<u8>(type));
+                ++quad_count;
             }
         }
 
-        const auto vertex_size = sizeof(Vertex) * m_vertices.size();
-        if (m_vertexBuffer->get_size() < vertex_size)
+        return quad_count;
+    }
+
+    void WorldRenderer::build_chunk_tilemap(const Chunk& chunk, ChunkRenderData& data)
+    {
+        m_texels.resize(ChunkArea);
+
+        data.IsPlaceholder = chunk.IsPending;
+        if (chunk.IsPending)
+        {
+            std::memset(m_texels.data(), PLACEHOLDER_SPRITE_INDEX, m_texels.size());
+        }
+        else
         {
-            // Recreate vertex buffer
-            m_vertexBuffer->init(vertex_size, vk::BufferUsageFlagBits::eVertexBuffer, true);
+            static_assert(sizeof(TileType) == sizeof(u8));
+            std::memcpy(m_texels.data(), chunk.Tiles.data(), ChunkArea);
         }
 
-        const auto index_size = sizeof(u32) * m_indices.size();
-        if (m_indexBuffer->get_size() < index_size)
+        if (data.TileTexture == nullptr)
+        {
+            data.TileTexture = m_renderer->create_texture();
+            data.TileTexture->init(ChunkSize, ChunkSize, vk::Format::eR8Uint, m_texels.data());
+        }
+        else
         {
-            // Recreate index buffer
-            m_indexBuffer->init(index_size, vk::BufferUsageFlagBits::eIndexBuffer, true);
+            data.TileTexture->write_region({ 0, 0 }, { ChunkSize, ChunkSize }, m_texels.data());
         }
+    }
 
-        m_vertexBuffer->write_data(0, sizeof(Vertex) * m_vertices.size(), m_vertices.data());
-        m_indexBuffer->write_data(0, sizeof(u32) * m_indices.size(), m_indices.data());
+    void WorldRenderer::update_chunk_tilemap(const Chunk& chunk, ChunkRenderData& data, const DirtyRegion& region)
+    {
+        const glm::uvec2 extent = region.Max - region.Min + 1u;
+        m_texels.resize(static_cast<sizet>(extent.x) * extent.y);
+        for (u32 row = 0; row < extent.y; ++row)
+        {
+            const auto* src = &chunk.Tiles[region.Min.x + (region.Min.y + row) * ChunkSize];
+            std::memcpy(&m_texels[row * extent.x], src, extent.x);
+        }
+
+        data.TileTexture->write_region(region.Min, extent, m_texels.data());
+    }
+
+    void WorldRenderer::build_chunk_impostor(const Chunk& chunk, ChunkRenderData& data)
+    {
+        write_impostor_texels(chunk, { 0, 0 }, { ChunkSize, ChunkSize });
+
+        data.TileImpostor = m_renderer->create_texture();
+        data.TileImpostor->init(ChunkSize, ChunkSize, vk::Format::eR8G8B8A8Srgb, m_impostorTexels.data());
+    }
+
+    void WorldRenderer::update_chunk_impostor(const Chunk& chunk, ChunkRenderData& data, const DirtyRegion& region)
+    {
+        const glm::uvec2 extent = region.Max - region.Min + 1u;
+        write_impostor_texels(chunk, region.Min, extent);
 
-        m_isDirty = false;
+        data.TileImpostor->write_region(region.Min, extent, m_impostorTexels.data());
     }
 
-    auto WorldRenderer::add_vertex(const glm::vec2& pos, const glm::vec2& uv) -> u32
+    void WorldRenderer::write_impostor_texels(const Chunk& chunk, const glm::uvec2& min, const glm::uvec2& extent)
     {
-        auto& vertex = m_vertices.emplace_back();
-        vertex.Position = pos;
-        vertex.TexCoord = uv;
+        m_impostorTexels.resize(static_cast<sizet>(extent.x) * extent.y);
+        for (u32 row = 0; row < extent.y; ++row)
+        {
+            for (u32 column = 0; column < extent.x; ++column)
+            {
+                auto& texel = m_impostorTexels[column + row * extent.x];
+                if (chunk.IsPending)
+                {
+                    texel = m_placeholderSprite->AverageColor;
+                    continue;
+                }
 
-        return static_cast<u32>(m_vertices.size() - 1);
+                const auto type = chunk.Tiles[(min.x + column) + (min.y + row) * ChunkSize];
+                const auto* sprite = m_tileSprites[static_cast<u32>(type)];
+                texel = sprite != nullptr ? sprite->AverageColor : glm::u8vec4(0);
+            }
+        }
     }
 
-    void WorldRenderer::add_quad(u32 a, u32 b, u32 c, u32 d)
+    void WorldRenderer::draw_chunk_impostor(const Chunk& chunk, const ChunkRenderData& data)
     {
-        m_indices.push_back(a);
-        m_indices.push_back(b);
-        m_indices.push_back(c);
-        m_indices.push_back(c);
-        m_indices.push_back(d);
-        m_indices.push_back(a);
+        // Unit quad scaled over the chunk, as in Tilemap mode
+        const f32 chunk_extent = m_world->get_tile_size() * ChunkSize;
+        const glm::vec2 origin = glm::vec2(chunk.Coord) * chunk_extent;
+
+        glm::mat4 push_data[2];
+        push_data[0] = m_renderer->get_view_projection();
+        push_data[1] = glm::scale(glm::translate(glm::mat4(1.0f), { origin, 0.0f }), { chunk_extent, chunk_extent, 1.0f });
+        m_renderer->set_push_constants(m_impostorShader.get(), sizeof(push_data), push_data);
+
+        m_renderer->bind_texture(m_impostorShader.get(), data.TileImpostor.get());
+        m_renderer->draw(6);
 
-        m_indexCount += 6;
+        ++m_drawnQuadCount;
+        ++m_drawnChunkCount;
     }
 
 }
@@ -2,21 +2,53 @@
 
 #include "core/core.hpp"
 
+#include "rendering/upload_token.hpp"
+
 #include "texture_atlas.hpp"
+#include "world.hpp"
+
+#include <array>
+#include <unordered_map>
+#include <vector>
 
 namespace app
 {
+    namespace core
+    {
+        class JobSystem;
+    }
+
     namespace gfx
     {
         class Renderer;
         class Shader;
         class Buffer;
+        class BufferPool;
+        class Texture;
     }
 
     namespace game
     {
-        class World;
+        enum class WorldRenderMode : u8
+        {
+            // One quad per tile in a mesh per chunk
+            Meshes,
+            // One 4 byte instance per tile, expanded into a quad by the vertex shader
+            Instanced,
+            // One quad per chunk, with the fragment shader looking tiles up in a per-chunk texture of tile types
+            Tilemap,
+            // Rectangles of identical tiles merged into single quads, with the sprite repeated across them in the fragment shader
+            Greedy,
+        };
 
+        /**
+         * Draws a World chunk by chunk.
+         * Only chunks overlapping the camera view are built and drawn. Each tile owns a fixed slot in its chunk's mesh, instance
+         * buffer or tile texture, so the World's dirty regions are applied by rewriting just those tiles. Greedy meshes have no
+         * fixed slots and are remeshed whole.
+         * When tiles shrink below the LOD threshold on screen, each chunk is instead drawn as one quad textured with an impostor,
+         * a texel per tile holding the tile sprite's average colour.
+         */
         class WorldRenderer
         {
         public:
@@ -26,40 +58,182 @@ namespace app
             void init(gfx::Renderer& renderer);
 
             void set_world(World& world);
+            /* Chunk builds are spread across the job system's workers, or run on the calling thread if nullptr. */
+            void set_job_system(core::JobSystem* job_system);
+            void set_render_mode(WorldRenderMode mode);
+            /* Chunks are drawn as impostors while a tile covers fewer than this many pixels on screen. */
+            void set_lod_threshold(f32 pixels_per_tile);
 
             /* Commands */
 
+            /* Drops all cached chunk data so each chunk is rebuilt when next drawn. */
             void force_rebuild();
 
             void render();
 
+            /* Getters */
+
+            auto get_render_mode() const -> WorldRenderMode;
+            auto get_lod_threshold() const -> f32;
+
+            bool is_using_impostors() const;
+
             auto get_vertex_count() const -> u32;
             auto get_triangle_count() const -> u32;
 
+            auto get_drawn_chunk_count() const -> u32;
+            auto get_culled_chunk_count() const -> u32;
+
+            /* Bytes of buffers and textures held for cached chunks. */
+            auto get_gpu_memory_usage() const -> sizet;
+
         private:
-            void rebuild_mesh();
+            struct Vertex;
+            struct TileInstance;
+            struct GreedyVertex;
+            struct ChunkRenderData;
+
+            void apply_dirty_regions();
+            void release_unused_chunks();
 
-            auto add_vertex(const glm::vec2& pos, const glm::vec2& uv) -> u32;
-            void add_quad(u32 a, u32 b, u32 c, u32 d);
+            /* Builds every queued chunk, filling staging memory in parallel when a job system is set. */
+            void flush_builds();
+            auto begin_chunk_build(const Chunk& chunk, ChunkRenderData& data) -> void*;
+
+            void draw_chunk(const Chunk& chunk, const ChunkRenderData& data);
+
+            void fill_chunk_mesh(const Chunk& chunk, Vertex* out) const;
+            void update_chunk_mesh(const Chunk& chunk, ChunkRenderData& data, const DirtyRegion& region);
+            void write_tile_quads(const Chunk& chunk, u32 first_x, u32 last_x, u32 y, Vertex* out) const;
+
+            void fill_chunk_instances(const Chunk& chunk, TileInstance* out) const;
+            void update_chunk_instances(const Chunk& chunk, ChunkRenderData& data, const DirtyRegion& region);
+            void write_tile_instances(const Chunk& chunk, u32 first_x, u32 last_x, u32 y, TileInstance* out) const;
+
+            /* Returns the number of quads written. */
+            auto fill_chunk_greedy(const Chunk& chunk, GreedyVertex* out) const -> u32;
+
+            void build_chunk_tilemap(const Chunk& chunk, ChunkRenderData& data);
+            void update_chunk_tilemap(const Chunk& chunk, ChunkRenderData& data, const DirtyRegion& region);
+
+            void build_chunk_impostor(const Chunk& chunk, ChunkRenderData& data);
+            void update_chunk_impostor(const Chunk& chunk, ChunkRenderData& data, const DirtyRegion& region);
+            /* Fills the impostor scratch texels for a rectangle of the chunk's tiles. */
+            void write_impostor_texels(const Chunk& chunk, const glm::uvec2& min, const glm::uvec2& extent);
+            void draw_chunk_impostor(const Chunk& chunk, const ChunkRenderData& data);
 
         private:
             gfx::Renderer* m_renderer = nullptr;
             World* m_world = nullptr;
+            core::JobSystem* m_jobSystem = nullptr;
+
+            WorldRenderMode m_renderMode = WorldRenderMode::Meshes;
+
+            f32 m_lodThreshold = 6.0f;
+            bool m_isUsingImpostors = false;
 
             Shared<gfx::Shader> m_shader = nullptr;
+            Shared<gfx::Shader> m_instancedShader = nullptr;
+            Shared<gfx::Shader> m_tilemapShader = nullptr;
+            Shared<gfx::Shader> m_greedyShader = nullptr;
+            Shared<gfx::Shader> m_impostorShader = nullptr;
             TextureAtlas m_atlas{};
 
-            Shared<gfx::Buffer> m_vertexBuffer = nullptr;
-            Shared<gfx::Buffer> m_indexBuffer = nullptr;
-            u32 m_indexCount = 0;
+            // Sprite for each TileType, resolved once from the atlas so meshing needs no name lookups
+            std::array<const Sprite*, TileTypeCount> m_tileSprites{};
+            const Sprite* m_placeholderSprite = nullptr;
+
+            // Instanced, Tilemap and Greedy modes: atlas UV rectangle per tile type, followed by the placeholder sprite's
+            Shared<gfx::Texture> m_spriteUVTexture = nullptr;
+
+            // Chunk buffers are ranges of a few large buffers, one pool per vertex layout, so consecutive chunks share a binding.
+            // Declared ahead of the chunk data so the pools outlive the buffers.
+            Shared<gfx::BufferPool> m_meshPool = nullptr;
+            Shared<gfx::BufferPool> m_instancePool = nullptr;
+            Shared<gfx::BufferPool> m_greedyPool = nullptr;
 
             struct Vertex
             {
                 glm::vec2 Position{};
                 glm::vec2 TexCoord{};
             };
-            std::vector<Vertex> m_vertices{};
-            std::vector<u32> m_indices{};
+
+            // Local tile coordinate, sprite index and size in tiles, read by the vertex shader as a uvec4
+            struct TileInstance
+            {
+                u8 X = 0;
+                u8 Y = 0;
+                u8 Sprite = 0;
+                u8 Size = 0;
+            };
+            static_assert(sizeof(TileInstance) == 4);
+
+            // Local tile coordinate of a quad corner and the sprite index, which the fragment shader repeats once per tile
+            struct GreedyVertex
+            {
+                u8 X = 0;
+                u8 Y = 0;
+                u8 Sprite = 0;
+                u8 Padding = 0;
+            };
+            static_assert(sizeof(GreedyVertex) == 4);
+
+            struct ChunkRenderData
+            {
+                u64 LastDrawnFrame = 0;
+
+                // Meshes and Greedy modes
+                Shared<gfx::Buffer> VertexBuffer = nullptr;
+                // Instanced mode
+                Shared<gfx::Buffer> InstanceBuffer = nullptr;
+                // Quads in the mesh or instances in the instance buffer
+                u32 QuadCount = 0;
+
+                // Tilemap mode, one texel per tile
+                Shared<gfx::Texture> TileTexture = nullptr;
+
+                // LOD, one texel per tile. Kept up to date alongside the render mode's data once created.
+                Shared<gfx::Texture> TileImpostor = nullptr;
+
+                // Batch streaming in the render mode's data when it was first built, the chunk is drawn once it is ready
+                gfx::UploadToken Upload{};
+
+                // The render mode's data has been built. Chunks first seen zoomed out only have an impostor.
+                bool IsBuilt = false;
+                // Holds the pending placeholder instead of the chunk's tiles
+                bool IsPlaceholder = false;
+            };
+            std::unordered_map<u64, ChunkRenderData> m_chunkData{};
+
+            // Quad index pattern for a full chunk, shared by every chunk mesh. Quad lx + ly * ChunkSize draws tile (lx, ly).
+            Shared<gfx::Buffer> m_indexBuffer = nullptr;
+
+            struct ChunkBuild
+            {
+                const Chunk* Source = nullptr;
+                ChunkRenderData* Data = nullptr;
+                void* Staging = nullptr;
+            };
+            std::vector<ChunkBuild> m_pendingBuilds{};
+
+            // Edits to chunks whose upload batch has not landed yet, keyed by chunk and applied by a later frame
+            std::unordered_map<u64, DirtyRegion> m_deferredRegions{};
+
+            struct VisibleChunk
+            {
+                const Chunk* Source = nullptr;
+                ChunkRenderData* Data = nullptr;
+            };
+            std::vector<VisibleChunk> m_visibleChunks{};
+
+            // Scratch space reused while updating tile textures and impostors
+            std::vector<u8> m_texels{};
+            std::vector<glm::u8vec4> m_impostorTexels{};
+
+            u64 m_frame = 0;
+            u32 m_drawnChunkCount = 0;
+            u32 m_culledChunkCount = 0;
+            u32 m_drawnQuadCount = 0;
 
             bool m_isDirty = false;
         };
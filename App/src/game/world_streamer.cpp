@@ -0,0 +1,268 @@
+#include "world_streamer.hpp"
+
+#include "world.hpp"
+#include "world_generator.hpp"
+#include "core/job_system.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace app::game
+{
+    namespace
+    {
+        // Extra ring of chunks requested around the view so panning rarely shows placeholders
+        constexpr i32 PrefetchChunks = 1;
+
+        // Keeps the job queue short so requests stay close to where the camera is now
+        constexpr u32 MaxJobsPerWorker = 2;
+    }
+
+    /* Shared with in-flight jobs, which may finish after the streamer has stopped or restarted. */
+    struct WorldStreamer::StreamState
+    {
+        struct Result
+        {
+            glm::uvec2 Coord{};
+            std::array<TileType, ChunkArea> Tiles{};
+        };
+
+        std::mutex mutex{};
+        std::vector<Owned<Result>> completed{};
+
+        std::atomic<u32> inFlight = 0;
+    };
+
+    WorldStreamer::WorldStreamer() = default;
+
+    WorldStreamer::~WorldStreamer()
+    {
+        stop();
+    }
+
+    void WorldStreamer::start(World& world, const WorldGenerator& generator, core::JobSystem& job_system)
+    {
+        stop();
+
+        m_world = &world;
+        m_generator = &generator;
+        m_jobSystem = &job_system;
+
+        m_state = CreateShared<StreamState>();
+    }
+
+    void WorldStreamer::stop()
+    {
+        // In-flight jobs keep the old state alive and their results are dropped with it
+        m_state = nullptr;
+
+        m_records.clear();
+        m_pendingCount = 0;
+
+        m_world = nullptr;
+        m_generator = nullptr;
+        m_jobSystem = nullptr;
+    }
+
+    void WorldStreamer::set_memory_budget(sizet bytes)
+    {
+        m_memoryBudget = bytes;
+    }
+
+    void WorldStreamer::set_generation_steps(u32 steps)
+    {
+        m_generationSteps = steps;
+    }
+
+    bool WorldStreamer::is_running() const
+    {
+        return m_state != nullptr;
+    }
+
+    auto WorldStreamer::get_memory_budget() const -> sizet
+    {
+        return m_memoryBudget;
+    }
+
+    auto WorldStreamer::get_resident_count() const -> u32
+    {
+        return static_cast<u32>(m_records.size());
+    }
+
+    auto WorldStreamer::get_pending_count() const -> u32
+    {
+        return m_pendingCount;
+    }
+
+    auto WorldStreamer::update(const glm::vec2& view_min, const glm::vec2& view_max) -> bool
+    {
+        if (!is_running())
+        {
+            return false;
+        }
+
+        ++m_frame;
+
+        bool has_changed = install_completed();
+
+        // Chunk range overlapping the view, clamped to the world
+        const f32 chunk_extent = m_world->get_tile_size() * ChunkSize;
+        const i32 max_chunk = static_cast<i32>((m_world->get_width() - 1) / ChunkSize);
+        const i32 min_x = glm::clamp(static_cast<i32>(glm::floor(view_min.x / chunk_extent)) - PrefetchChunks, 0, max_chunk);
+        const i32 min_y = glm::clamp(static_cast<i32>(glm::floor(view_min.y / chunk_extent)) - PrefetchChunks, 0, max_chunk);
+        const i32 max_x = glm::clamp(static_cast<i32>(glm::floor(view_max.x / chunk_extent)) + PrefetchChunks, 0, max_chunk);
+        const i32 max_y = glm::clamp(static_cast<i32>(glm::floor(view_max.y / chunk_extent)) + PrefetchChunks, 0, max_chunk);
+
+        std::vector<glm::uvec2> missing{};
+        for (i32 y = min_y; y <= max_y; ++y)
+        {
+            for (i32 x = min_x; x <= max_x; ++x)
+            {
+                const glm::uvec2 coord{ static_cast<u32>(x), static_cast<u32>(y) };
+                auto it = m_records.find(World::get_chunk_key(coord));
+                if (it != m_records.end())
+                {
+                    it->second.LastUsedFrame = m_frame;
+                }
+                else
+                {
+                    missing.push_back(coord);
+                }
+            }
+        }
+
+        // Closest chunks first
+        const glm::vec2 view_centre = (view_min + view_max) * 0.5f / chunk_extent;
+        std::sort(missing.begin(),
+                  missing.end(),
+                  [&](const glm::uvec2& a, const glm::uvec2& b)
+                  {
+                      const glm::vec2 da = glm::vec2(a) + 0.5f - view_centre;
+                      const glm::vec2 db = glm::vec2(b) + 0.5f - view_centre;
+                      return da.x * da.x + da.y * da.y < db.x * db.x + db.y * db.y;
+                  });
+
+        const u32 max_in_flight = std::max(m_jobSystem->get_thread_count(), 1u) * MaxJobsPerWorker;
+        for (const auto& coord : missing)
+        {
+            if (m_state->inFlight.load() >= max_in_flight)
+            {
+                break;
+            }
+
+            auto& record = m_records[World::get_chunk_key(coord)];
+            record.Coord = coord;
+            record.LastUsedFrame = m_frame;
+            record.IsPending = true;
+            ++m_pendingCount;
+
+            m_world->get_or_create_chunk(coord).IsPending = true;
+            has_changed = true;
+
+            m_state->inFlight.fetch_add(1);
+            m_jobSystem->submit(
+                [state = m_state, generator = m_generator, coord, steps = m_generationSteps]
+                {
+                    auto result = CreateOwned<StreamState::Result>();
+                    result->Coord = coord;
+                    generator->generate_chunk(coord, steps, result->Tiles);
+
+                    {
+                        std::lock_guard lock(state->mutex);
+                        state->completed.push_back(std::move(result));
+                    }
+                    state->inFlight.fetch_sub(1);
+                });
+        }
+
+        has_changed |= evict_over_budget();
+
+        return has_changed;
+    }
+
+    auto WorldStreamer::install_completed() -> bool
+    {
+        std::vector<Owned<StreamState::Result>> completed{};
+        {
+            // Skip a frame rather than wait on a worker that is handing in a result
+            std::unique_lock lock(m_state->mutex, std::try_to_lock);
+            if (!lock.owns_lock())
+            {
+                return false;
+            }
+
+            std::swap(completed, m_state->completed);
+        }
+
+        bool has_changed = false;
+        for (const auto& result : completed)
+        {
+            auto it = m_records.find(World::get_chunk_key(result->Coord));
+            if (it == m_records.end() || !it->second.IsPending)
+            {
+                // Evicted while it was being generated
+                continue;
+            }
+
+            auto& chunk = m_world->get_or_create_chunk(result->Coord);
+            chunk.Tiles = result->Tiles;
+            chunk.IsPending = false;
+
+            it->second.IsPending = false;
+            --m_pendingCount;
+            has_changed = true;
+        }
+
+        return has_changed;
+    }
+
+    auto WorldStreamer::evict_over_budget() -> bool
+    {
+        const sizet max_chunks = std::max<sizet>(m_memoryBudget / sizeof(Chunk), 1);
+        if (m_records.size() <= max_chunks)
+        {
+            return false;
+        }
+
+        // Only chunks that were not touched this frame are candidates, oldest first
+        std::vector<const ChunkRecord*> candidates{};
+        for (const auto& [key, record] : m_records)
+        {
+            if (record.LastUsedFrame != m_frame)
+            {
+                candidates.push_back(&record);
+            }
+        }
+
+        const sizet evict_count = std::min(m_records.size() - max_chunks, candidates.size());
+        std::nth_element(candidates.begin(),
+                         candidates.begin() + static_cast<i64>(evict_count),
+                         candidates.end(),
+                         [](const ChunkRecord* a, const ChunkRecord* b) { return a->LastUsedFrame < b->LastUsedFrame; });
+
+        std::vector<glm::uvec2> evicted{};
+        for (sizet i = 0; i < evict_count; ++i)
+        {
+            evicted.push_back(candidates[i]->Coord);
+        }
+
+        for (const auto& coord : evicted)
+        {
+            const auto key = World::get_chunk_key(coord);
+            if (m_records[key].IsPending)
+            {
+                --m_pendingCount;
+            }
+
+            m_records.erase(key);
+            m_world->remove_chunk(coord);
+        }
+
+        return !evicted.empty();
+    }
+
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "core/core.hpp"
+
+#include <glm/ext/vector_float2.hpp>
+#include <glm/ext/vector_uint2.hpp>
+
+#include <unordered_map>
+
+namespace app
+{
+    namespace core
+    {
+        class JobSystem;
+    }
+
+    namespace game
+    {
+        class World;
+        class WorldGenerator;
+
+        /* Side length in tiles of the world used while streaming. Large enough to never reach an edge in practice. */
+        constexpr u32 StreamingWorldSize = 1u << 18;
+
+        /**
+         * Keeps the chunks around the camera resident in a World.
+         * Missing chunks are generated on worker threads and appear as pending placeholders until ready.
+         * Chunks outside the view are evicted least recently used first once over the memory budget.
+         */
+        class WorldStreamer
+        {
+        public:
+            WorldStreamer();
+            ~WorldStreamer();
+
+            /* Initialisation/Shutdown */
+
+            void start(World& world, const WorldGenerator& generator, core::JobSystem& job_system);
+            void stop();
+
+            /* Setters */
+
+            void set_memory_budget(sizet bytes);
+            void set_generation_steps(u32 steps);
+
+            /* Getters */
+
+            bool is_running() const;
+
+            auto get_memory_budget() const -> sizet;
+            auto get_resident_count() const -> u32;
+            auto get_pending_count() const -> u32;
+
+            /* Commands */
+
+            /**
+             * Requests the chunks overlapping the view, installs finished chunks and evicts over budget.
+             * Never waits on a worker. Returns true if any chunk in the World changed.
+             */
+            auto update(const glm::vec2& view_min, const glm::vec2& view_max) -> bool;
+
+        private:
+            auto install_completed() -> bool;
+            auto evict_over_budget() -> bool;
+
+        private:
+            struct ChunkRecord
+            {
+                glm::uvec2 Coord{};
+                u64 LastUsedFrame = 0;
+                bool IsPending = true;
+            };
+
+            struct StreamState;
+
+            World* m_world = nullptr;
+            const WorldGenerator* m_generator = nullptr;
+            core::JobSystem* m_jobSystem = nullptr;
+
+            Shared<StreamState> m_state = nullptr;
+
+            std::unordered_map<u64, ChunkRecord> m_records{};
+            u64 m_frame = 0;
+            u32 m_pendingCount = 0;
+
+            sizet m_memoryBudget = 64ull * 1024 * 1024;
+            u32 m_generationSteps = 4;
+        };
+    }
+}
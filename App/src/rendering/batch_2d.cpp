@@ -1,42 +1,286 @@
 #include "batch_2d.hpp"
 
 #include "renderer.hpp"
+#include "device.hpp"
+#include "shader.hpp"
 #include "buffer.hpp"
+#include "texture.hpp"
+
+#include "core/radix_sort.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 namespace app::gfx
 {
-    static sizet MaxQuadCount = 10000;
-    static sizet MaxVertexCount = MaxQuadCount * 4;
-    static sizet MaxIndexCount = MaxQuadCount * 6;
-    static sizet MaxTextures = 32;  // TODO: Query vulkan for max textures
+    // Per frame in flight
+    static u32 InitialQuadCapacity = 10000;
+
+    // One per quad, the vertex shader expands it into the quad's corners
+    struct SpriteInstance
+    {
+        glm::vec2 Position;
+        glm::vec2 Size;
+        // Min and max UV as 16-bit unorm
+        std::array<u16, 4> UVRect;
+        // RGBA8
+        u32 Color;
+        // Slot in the draw's texture array, filled in when the batch is sorted
+        u16 TexIndex;
+        // Angle about the quad's centre as 16-bit unorm of a full turn
+        u16 Rotation;
+    };
+    static_assert(sizeof(SpriteInstance) == 32);
+
+    // A quad held by its context until end_batch() sorts it
+    struct QueuedQuad
+    {
+        SpriteInstance Instance{};
+        u64 Key = 0;
+        Texture* BoundTexture = nullptr;
+        Shader* BoundShader = nullptr;
+    };
+
+    namespace
+    {
+        auto pack_unorm16(f32 value) -> u16
+        {
+            return static_cast<u16>(glm::clamp(value, 0.0f, 1.0f) * 65535.0f + 0.5f);
+        }
+
+        auto pack_unorm8x4(const glm::vec4& value) -> u32
+        {
+            const auto pack = [](f32 channel) { return static_cast<u32>(glm::clamp(channel, 0.0f, 1.0f) * 255.0f + 0.5f); };
+            return pack(value.x) | (pack(value.y) << 8) | (pack(value.z) << 16) | (pack(value.w) << 24);
+        }
 
-    struct Vertex
+        // Maps a float to 24 bits that compare in the same order, keeping the sign, exponent and top 15 bits of mantissa
+        auto pack_sort_depth(f32 depth) -> u32
+        {
+            u32 bits = 0;
+            std::memcpy(&bits, &depth, sizeof(bits));
+            bits ^= (bits & 0x80000000) != 0 ? 0xffffffff : 0x80000000;
+            return bits >> 8;
+        }
+
+        // Layer in the top 16 bits, biased so negative layers come first, then 24 bits of depth, 8 bits of shader id and 16 bits
+        // of texture id. Ids share their low bits once there are more shaders or textures than that, which only costs batching.
+        auto make_sort_key(i16 layer, u32 depth, u32 shader_id, u32 texture_id) -> u64
+        {
+            const u64 biased_layer = static_cast<u64>(static_cast<i32>(layer) + 32768);
+            return (biased_layer << 48) | (static_cast<u64>(depth) << 24) | (static_cast<u64>(shader_id & 0xff) << 16) |
+                   (texture_id & 0xffff);
+        }
+
+        std::atomic<u32> s_nextBatchId = 1;
+
+        struct ThreadContext
+        {
+            u32 BatchId = 0;
+            Batch2DContext* Context = nullptr;
+            // Expires when the batch shuts down
+            std::weak_ptr<void> BatchLifetime{};
+        };
+        // Contexts claimed by this thread. Batch ids are never reused, so entries left by a shut down batch never match again,
+        // and they are dropped the next time the thread claims a context.
+        thread_local std::vector<ThreadContext> t_threadContexts{};
+    }
+
+    struct Batch2DContext::ContextData
     {
-        glm::vec3 Position;
-        glm::vec4 Color;
-        glm::vec2 TexCoord;
-        f32 TexIndex;
+        Texture* whiteTexture = nullptr;
+        Shader* defaultShader = nullptr;
+
+        std::vector<QueuedQuad> quads{};
+
+        struct SequenceRun
+        {
+            u32 Sequence = 0;
+            // Index of the run's first quad, it ends where the next run starts
+            u32 FirstQuad = 0;
+        };
+        std::vector<SequenceRun> sequenceRuns{};
+
+        i16 layer = 0;
+        Shader* shader = nullptr;
+        bool isYSorted = false;
     };
 
     struct Batch2D::BatchData
     {
         bool initialised = false;
+        u32 id = 0;
+        Shared<u8> lifetime = nullptr;
 
         Renderer* renderer = nullptr;
 
-        Shared<Buffer> vertexBuffer = nullptr;
-        Shared<Buffer> indexBuffer = nullptr;
-
-        // Texture whiteTexture;
+        Shared<Shader> defaultShader = nullptr;
+        Shared<Texture> whiteTexture = nullptr;
 
-        u32 indexCount = 0;  // How many indices to draw when flushing
+        // Split into one region per frame in flight and mapped for its whole lifetime, so quads are written straight to the GPU
+        Shared<Buffer> instanceBuffer = nullptr;
+        SpriteInstance* mappedInstances = nullptr;
+        u32 quadCapacity = 0;
 
-        std::vector<Vertex> quadBuffer{};
+        struct FrameRegion
+        {
+            u64 FrameNumber = 0;
+            // Quads already written this frame, later batches append after them
+            u32 QuadCount = 0;
+        };
+        std::array<FrameRegion, FramesInFlight> frameRegions{};
+        // First instance of the last end_batch() in the instance buffer
+        u32 batchFirstInstance = 0;
+
+        // Guards contexts while a thread claims a new one
+        std::mutex contextMutex{};
+        std::vector<Owned<Batch2DContext>> contexts{};
+        // Drawn into by the Batch2D's own draw_quad()
+        Batch2DContext* ownerContext = nullptr;
+
+        struct SortEntry
+        {
+            u64 Key = 0;
+            const QueuedQuad* Source = nullptr;
+        };
+        struct QuadRun
+        {
+            u32 Sequence = 0;
+            const QueuedQuad* Begin = nullptr;
+            const QueuedQuad* End = nullptr;
+        };
+        std::vector<QuadRun> quadRuns{};
+        std::vector<SortEntry> sortEntries{};
+        std::vector<SortEntry> sortScratch{};
+        f32 lastSortTime = 0.0f;
+
+        struct DrawCall
+        {
+            Shader* BoundShader = nullptr;
+            std::vector<Texture*> Textures{};
+            u32 FirstInstance = 0;
+            u32 InstanceCount = 0;
+        };
+        std::vector<DrawCall> drawCalls{};
+        u32 lastDrawCallCount = 0;
+
+        auto get_frame_region() -> FrameRegion&
+        {
+            auto& region = frameRegions[renderer->get_frame_index()];
+            if (region.FrameNumber != renderer->get_frame_number())
+            {
+                // This slot's previous frame has finished on the GPU
+                region.FrameNumber = renderer->get_frame_number();
+                region.QuadCount = 0;
+            }
+
+            return region;
+        }
 
-        // std::array<Texture, MaxTextures> textureSlots;
-        u32 textureSlotIndex = 1;
+        /* Grows the buffers so each frame region holds at least quad_count quads. */
+        void reserve_quads(u32 quad_count)
+        {
+            if (quad_count <= quadCapacity)
+            {
+                return;
+            }
+
+            quadCapacity = std::max(quadCapacity, InitialQuadCapacity);
+            while (quadCapacity < quad_count)
+            {
+                quadCapacity *= 2;
+            }
+
+            // Batches recorded earlier still draw from the old buffer, which the device destroys once their frames finish
+            if (instanceBuffer != nullptr)
+            {
+                get_frame_region().QuadCount = 0;
+            }
+
+            instanceBuffer = renderer->create_buffer();
+            const sizet buffer_size = sizeof(SpriteInstance) * quadCapacity * FramesInFlight;
+            instanceBuffer->init(buffer_size, vk::BufferUsageFlagBits::eVertexBuffer, BufferMemory::PersistentlyMapped);
+            mappedInstances = static_cast<SpriteInstance*>(instanceBuffer->get_mapped_data());
+        }
     };
 
+    Batch2DContext::Batch2DContext(ContextData* data) : m_pimpl(data) {}
+
+    Batch2DContext::~Batch2DContext() = default;
+
+    void Batch2DContext::set_layer(i16 layer)
+    {
+        m_pimpl->layer = layer;
+    }
+
+    void Batch2DContext::set_shader(Shader* shader)
+    {
+        m_pimpl->shader = shader;
+    }
+
+    void Batch2DContext::set_y_sorted(bool is_y_sorted)
+    {
+        m_pimpl->isYSorted = is_y_sorted;
+    }
+
+    void Batch2DContext::set_sequence(u32 sequence)
+    {
+        const auto first_quad = static_cast<u32>(m_pimpl->quads.size());
+        auto& runs = m_pimpl->sequenceRuns;
+        if (!runs.empty() && runs.back().FirstQuad == first_quad)
+        {
+            runs.back().Sequence = sequence;
+            return;
+        }
+
+        runs.push_back({ sequence, first_quad });
+    }
+
+    void Batch2DContext::draw_quad(const glm::vec2& position, const glm::vec2& size, const glm::vec4& color)
+    {
+        draw_quad(position, size, m_pimpl->whiteTexture, { 0.0f, 0.0f }, { 1.0f, 1.0f }, color);
+    }
+
+    void Batch2DContext::draw_quad(const glm::vec2& position, const glm::vec2& size, Texture* texture, const glm::vec4& tint)
+    {
+        draw_quad(position, size, texture, { 0.0f, 0.0f }, { 1.0f, 1.0f }, tint);
+    }
+
+    void Batch2DContext::draw_quad(const glm::vec2& position,
+                                   const glm::vec2& size,
+                                   Texture* texture,
+                                   const glm::vec2& min_uv,
+                                   const glm::vec2& max_uv,
+                                   const glm::vec4& tint,
+                                   f32 rotation)
+    {
+        ASSERT(texture != nullptr);
+
+        auto* shader = m_pimpl->shader != nullptr ? m_pimpl->shader : m_pimpl->defaultShader;
+
+        QueuedQuad& quad = m_pimpl->quads.emplace_back();
+        quad.Instance.Position = position;
+        quad.Instance.Size = size;
+        quad.Instance.UVRect = { pack_unorm16(min_uv.x), pack_unorm16(min_uv.y), pack_unorm16(max_uv.x), pack_unorm16(max_uv.y) };
+        quad.Instance.Color = pack_unorm8x4(tint);
+        quad.Instance.Rotation = pack_unorm16(glm::fract(rotation / glm::two_pi<f32>()));
+
+        // The quad's bottom edge on screen, so sprites further down cover those behind them
+        const u32 depth = m_pimpl->isYSorted ? pack_sort_depth(position.y + size.y) : 0;
+        quad.Key = make_sort_key(m_pimpl->layer, depth, shader->get_id(), texture->get_id());
+        quad.BoundTexture = texture;
+        quad.BoundShader = shader;
+    }
+
     Batch2D::Batch2D() : m_pimpl(new Batch2D::BatchData) {}
 
     Batch2D::~Batch2D()
@@ -49,113 +293,275 @@ namespace app::gfx
         ASSERT(m_pimpl->initialised == false);
         m_pimpl->initialised = true;
 
+        m_pimpl->id = s_nextBatchId++;
+        m_pimpl->lifetime = CreateShared<u8>();
         m_pimpl->renderer = &renderer;
 
-        // Pre-Allocate vertex buffer
-        m_pimpl->quadBuffer.reserve(MaxVertexCount);
+        ShaderInfo shader_info{};
+        shader_info.VertexFile = "../../assets/shaders/batch_2d.vert.spv";
+        shader_info.FragmentFile = "../../assets/shaders/batch_2d.frag.spv";
+        shader_info.VertexAttributes = {
+            vk::Format::eR32G32Sfloat,        // Position
+            vk::Format::eR32G32Sfloat,        // Size
+            vk::Format::eR16G16B16A16Unorm,   // UV rect
+            vk::Format::eR8G8B8A8Unorm,       // Color
+            vk::Format::eR16G16Uint,          // Texture index, rotation
+        };
+        shader_info.VertexInputRate = vk::VertexInputRate::eInstance;
+        shader_info.TextureSetCount = 0;
+        shader_info.TextureArraySetCount = 1;
+        m_pimpl->defaultShader = renderer.create_shader();
+        m_pimpl->defaultShader->init(shader_info);
+
+        // Untextured quads sample a 1x1 white texture, so they batch with textured ones
+        const u32 white = 0xffffffff;
+        m_pimpl->whiteTexture = renderer.create_texture();
+        m_pimpl->whiteTexture->init(1, 1, vk::Format::eR8G8B8A8Unorm, &white);
+
+        m_pimpl->ownerContext = &create_context();
+        m_pimpl->ownerContext->m_pimpl->quads.reserve(InitialQuadCapacity);
+        m_pimpl->sortEntries.reserve(InitialQuadCapacity);
+        m_pimpl->reserve_quads(InitialQuadCapacity);
+    }
+
+    void Batch2D::shutdown()
+    {
+        m_pimpl->instanceBuffer = nullptr;
+        m_pimpl->mappedInstances = nullptr;
+        m_pimpl->quadCapacity = 0;
+        m_pimpl->frameRegions = {};
 
-        // Create Quad buffers
-        m_pimpl->vertexBuffer = m_pimpl->renderer->create_buffer();
-        m_pimpl->vertexBuffer->init(sizeof(Vertex) * MaxVertexCount, vk::BufferUsageFlagBits::eVertexBuffer, true);
+        m_pimpl->defaultShader = nullptr;
+        m_pimpl->whiteTexture = nullptr;
 
-        // Pre-Generate quad indices
-        std::vector<u32> indices(MaxIndexCount);
-        u32 offset = 0;
-        for (sizet i = 0; i < MaxIndexCount; i += 6)
-        {
-            indices[i + 0] = 0 + offset;
-            indices[i + 1] = 1 + offset;
-            indices[i + 2] = 2 + offset;
+        // Clear data
+        m_pimpl->ownerContext = nullptr;
+        m_pimpl->contexts.clear();
+        m_pimpl->lifetime = nullptr;
+        std::erase_if(t_threadContexts, [id = m_pimpl->id](const ThreadContext& context) { return context.BatchId == id; });
+        m_pimpl->sortEntries.clear();
+        m_pimpl->sortEntries.shrink_to_fit();
+        m_pimpl->sortScratch.clear();
+        m_pimpl->sortScratch.shrink_to_fit();
+        m_pimpl->quadRuns.clear();
+        m_pimpl->drawCalls.clear();
+
+        m_pimpl->initialised = false;
+    }
 
-            indices[i + 3] = 2 + offset;
-            indices[i + 4] = 3 + offset;
-            indices[i + 5] = 0 + offset;
+    void Batch2D::set_layer(i16 layer)
+    {
+        m_pimpl->ownerContext->set_layer(layer);
+    }
+
+    void Batch2D::set_shader(Shader* shader)
+    {
+        m_pimpl->ownerContext->set_shader(shader);
+    }
+
+    void Batch2D::set_y_sorted(bool is_y_sorted)
+    {
+        m_pimpl->ownerContext->set_y_sorted(is_y_sorted);
+    }
 
-            offset += 4;
+    auto Batch2D::get_quad_count() const -> u32
+    {
+        sizet quad_count = 0;
+        for (const auto& context : m_pimpl->contexts)
+        {
+            quad_count += context->m_pimpl->quads.size();
         }
-        m_pimpl->indexBuffer = m_pimpl->renderer->create_buffer();
-        m_pimpl->indexBuffer->init(
-            sizeof(u32) * MaxIndexCount, vk::BufferUsageFlagBits::eIndexBuffer, true);  // #TODO: Remove force mappable
-        m_pimpl->indexBuffer->write_data(0, sizeof(u32) * indices.size(), indices.data());
 
-        // Create 1x1 white texture
-        // u32 color = 0xffffffff;
-        // #TODO: Create texture
+        return static_cast<u32>(quad_count);
+    }
+
+    auto Batch2D::get_sort_time() const -> f32
+    {
+        return m_pimpl->lastSortTime;
+    }
 
-        // m_pimpl->textureSlots[0] = m_pimpl->whiteTexture;
-        for (sizet i = 1; i < MaxTextures; ++i)
+    auto Batch2D::get_thread_context() -> Batch2DContext&
+    {
+        for (const auto& thread_context : t_threadContexts)
         {
-            // m_pimpl->textureSlots[i]
+            if (thread_context.BatchId == m_pimpl->id)
+            {
+                return *thread_context.Context;
+            }
         }
+
+        std::erase_if(t_threadContexts, [](const ThreadContext& context) { return context.BatchLifetime.expired(); });
+
+        std::lock_guard lock(m_pimpl->contextMutex);
+        auto& context = create_context();
+        t_threadContexts.push_back({ m_pimpl->id, &context, m_pimpl->lifetime });
+        return context;
     }
 
-    void Batch2D::shutdown()
+    auto Batch2D::create_context() -> Batch2DContext&
     {
-        m_pimpl->vertexBuffer = nullptr;
-        m_pimpl->indexBuffer = nullptr;
+        auto* data = new Batch2DContext::ContextData;
+        data->whiteTexture = m_pimpl->whiteTexture.get();
+        data->defaultShader = m_pimpl->defaultShader.get();
 
-        // Clear data
-        m_pimpl->quadBuffer.clear();
-        m_pimpl->quadBuffer.shrink_to_fit();
+        return *m_pimpl->contexts.emplace_back(new Batch2DContext(data));
     }
 
-    void Batch2D::begin_batch()
+    auto Batch2D::get_draw_call_count() const -> u32
     {
-        m_pimpl->quadBuffer.clear();
+        return m_pimpl->lastDrawCallCount;
     }
 
-    void Batch2D::end_batch()
+    void Batch2D::begin_batch()
     {
-        sizet size = m_pimpl->quadBuffer.size() * sizeof(Vertex);
-        m_pimpl->vertexBuffer->write_data(0, size, m_pimpl->quadBuffer.data());
+        for (const auto& context : m_pimpl->contexts)
+        {
+            context->m_pimpl->quads.clear();
+            context->m_pimpl->sequenceRuns.clear();
+            context->m_pimpl->layer = 0;
+            context->m_pimpl->shader = nullptr;
+            context->m_pimpl->isYSorted = false;
+        }
+        m_pimpl->drawCalls.clear();
     }
 
-    void Batch2D::flush()
+    void Batch2D::end_batch()
     {
-        // #TODO: Update texture descriptor binding
+        // Split every context's quads into runs of one sequence, quads drawn before a context's first set_sequence() have sequence 0
+        auto& runs = m_pimpl->quadRuns;
+        runs.clear();
+        for (const auto& context : m_pimpl->contexts)
+        {
+            const auto& quads = context->m_pimpl->quads;
+            const auto& sequence_runs = context->m_pimpl->sequenceRuns;
+
+            u32 run_start = 0;
+            u32 sequence = 0;
+            for (const auto& sequence_run : sequence_runs)
+            {
+                runs.push_back({ sequence, quads.data() + run_start, quads.data() + sequence_run.FirstQuad });
+                run_start = sequence_run.FirstQuad;
+                sequence = sequence_run.Sequence;
+            }
+            runs.push_back({ sequence, quads.data() + run_start, quads.data() + quads.size() });
+        }
+
+        // Gathered in sequence order, then context creation order, so quads with equal keys keep an order that does not depend on
+        // which thread drew them
+        std::stable_sort(
+            runs.begin(), runs.end(), [](const BatchData::QuadRun& a, const BatchData::QuadRun& b) { return a.Sequence < b.Sequence; });
+
+        auto& entries = m_pimpl->sortEntries;
+        entries.clear();
+        entries.reserve(get_quad_count());
+        for (const auto& run : runs)
+        {
+            for (const auto* quad = run.Begin; quad != run.End; ++quad)
+            {
+                entries.push_back({ quad->Key, quad });
+            }
+        }
+
+        const auto quad_count = static_cast<u32>(entries.size());
+        if (quad_count == 0)
+        {
+            return;
+        }
+
+        // Stable, so quads with equal keys keep the order they were gathered in
+        const auto sort_start = std::chrono::steady_clock::now();
+        core::radix_sort(entries, m_pimpl->sortScratch, [](const BatchData::SortEntry& entry) { return entry.Key; });
+        m_pimpl->lastSortTime = std::chrono::duration<f32, std::milli>(std::chrono::steady_clock::now() - sort_start).count();
+
+        // Append after the batches already drawn this frame, growing the buffers if this frame's region is full
+        if (m_pimpl->get_frame_region().QuadCount + quad_count > m_pimpl->quadCapacity)
+        {
+            m_pimpl->reserve_quads(std::max(quad_count, m_pimpl->quadCapacity + 1));
+        }
+
+        auto& region = m_pimpl->get_frame_region();
+        const u32 first_quad = m_pimpl->renderer->get_frame_index() * m_pimpl->quadCapacity + region.QuadCount;
+        region.QuadCount += quad_count;
 
-        m_pimpl->renderer->draw_indexed(m_pimpl->vertexBuffer.get(), m_pimpl->indexBuffer.get(), m_pimpl->indexCount);
+        m_pimpl->batchFirstInstance = first_quad;
+        auto* instances = m_pimpl->mappedInstances + first_quad;
 
-        m_pimpl->indexCount = 0;
-        m_pimpl->textureSlotIndex = 1;
+        BatchData::DrawCall* draw_call = nullptr;
+        for (u32 i = 0; i < quad_count; ++i)
+        {
+            const auto& quad = *entries[i].Source;
+
+            // Y-sorted quads interleave their textures by depth, so the call's slots are searched rather than only the last one
+            sizet texture_slot = 0;
+            if (draw_call != nullptr && draw_call->BoundShader == quad.BoundShader)
+            {
+                const auto& textures = draw_call->Textures;
+                texture_slot = static_cast<sizet>(std::find(textures.begin(), textures.end(), quad.BoundTexture) - textures.begin());
+            }
+
+            if (draw_call == nullptr || draw_call->BoundShader != quad.BoundShader || texture_slot == TextureArraySize)
+            {
+                draw_call = &m_pimpl->drawCalls.emplace_back();
+                draw_call->BoundShader = quad.BoundShader;
+                draw_call->FirstInstance = i;
+                texture_slot = 0;
+            }
+
+            if (texture_slot == draw_call->Textures.size())
+            {
+                draw_call->Textures.push_back(quad.BoundTexture);
+            }
+            ++draw_call->InstanceCount;
+
+            // Mapped memory may be write-combined, so the instance is completed locally and stored whole
+            auto instance = quad.Instance;
+            instance.TexIndex = static_cast<u16>(texture_slot);
+            instances[i] = instance;
+        }
+
+        m_pimpl->instanceBuffer->flush_range(sizeof(SpriteInstance) * first_quad, sizeof(SpriteInstance) * quad_count);
     }
 
-    void Batch2D::draw_quad(const glm::vec2& position, const glm::vec2& size, const glm::vec4& color)
+    void Batch2D::flush()
     {
-        if (m_pimpl->indexCount >= MaxIndexCount)
+        auto* renderer = m_pimpl->renderer;
+
+        glm::mat4 push_data[2];
+        push_data[0] = renderer->get_view_projection();
+        push_data[1] = glm::mat4(1.0f);
+
+        for (const auto& draw_call : m_pimpl->drawCalls)
         {
-            end_batch();
-            flush();
-            begin_batch();
+            renderer->bind_shader(draw_call.BoundShader);
+            renderer->set_push_constants(draw_call.BoundShader, sizeof(push_data), push_data);
+            renderer->bind_textures(draw_call.BoundShader, draw_call.Textures, 0);
+            renderer->draw_instanced(
+                m_pimpl->instanceBuffer.get(), 6, draw_call.InstanceCount, m_pimpl->batchFirstInstance + draw_call.FirstInstance);
         }
 
-        f32 textureIndex = 0.0f;
-         
-        auto* vert = &m_pimpl->quadBuffer.emplace_back();
-        vert->Position = { position.x, position.y, 0.0f };
-        vert->Color = color;
-        vert->TexCoord = { 0.0f, 0.0f };
-        vert->TexIndex = textureIndex;
-
-        vert = &m_pimpl->quadBuffer.emplace_back();
-        vert->Position = { position.x + size.x, position.y, 0.0f };
-        vert->Color = color;
-        vert->TexCoord = { 1.0f, 0.0f };
-        vert->TexIndex = textureIndex;
+        m_pimpl->lastDrawCallCount = static_cast<u32>(m_pimpl->drawCalls.size());
+        m_pimpl->drawCalls.clear();
+    }
 
-        vert = &m_pimpl->quadBuffer.emplace_back();
-        vert->Position = { position.x + size.x, position.y + size.y, 0.0f };
-        vert->Color = color;
-        vert->TexCoord = { 1.0f, 1.0f };
-        vert->TexIndex = textureIndex;
+    void Batch2D::draw_quad(const glm::vec2& position, const glm::vec2& size, const glm::vec4& color)
+    {
+        m_pimpl->ownerContext->draw_quad(position, size, color);
+    }
 
-        vert = &m_pimpl->quadBuffer.emplace_back();
-        vert->Position = { position.x, position.y + size.y, 0.0f };
-        vert->Color = color;
-        vert->TexCoord = { 0.0f, 1.0f };
-        vert->TexIndex = textureIndex;
+    void Batch2D::draw_quad(const glm::vec2& position, const glm::vec2& size, Texture* texture, const glm::vec4& tint)
+    {
+        m_pimpl->ownerContext->draw_quad(position, size, texture, tint);
+    }
 
-        m_pimpl->indexCount += 6;
+    void Batch2D::draw_quad(const glm::vec2& position,
+                            const glm::vec2& size,
+                            Texture* texture,
+                            const glm::vec2& min_uv,
+                            const glm::vec2& max_uv,
+                            const glm::vec4& tint,
+                            f32 rotation)
+    {
+        m_pimpl->ownerContext->draw_quad(position, size, texture, min_uv, max_uv, tint, rotation);
     }
 
 }
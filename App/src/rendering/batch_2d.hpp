@@ -5,7 +5,58 @@
 namespace app::gfx
 {
     class Renderer;
+    class Shader;
+    class Texture;
+    class Batch2D;
 
+    /**
+     * Quads submitted to a Batch2D from one thread, with its own layer and shader state.
+     * Each thread draws into its own context without locking, and end_batch() merges every context into one sorted batch.
+     */
+    class Batch2DContext
+    {
+    public:
+        ~Batch2DContext();
+
+        /* Setters */
+
+        void set_layer(i16 layer);
+        void set_shader(Shader* shader);
+        void set_y_sorted(bool is_y_sorted);
+        /**
+         * Applies to quads drawn afterwards, 0 until set. Quads with equal sort keys are drawn in order of their sequence, then in
+         * the order their contexts were created. Work split across threads can pass each part's index, such as the first index of
+         * a parallel_for range, so its draw order does not depend on which thread ran it.
+         */
+        void set_sequence(u32 sequence);
+
+        /* Commands */
+
+        void draw_quad(const glm::vec2& position, const glm::vec2& size, const glm::vec4& color);
+        void draw_quad(const glm::vec2& position, const glm::vec2& size, Texture* texture, const glm::vec4& tint = glm::vec4(1.0f));
+        void draw_quad(const glm::vec2& position,
+                       const glm::vec2& size,
+                       Texture* texture,
+                       const glm::vec2& min_uv,
+                       const glm::vec2& max_uv,
+                       const glm::vec4& tint = glm::vec4(1.0f),
+                       f32 rotation = 0.0f);
+
+    private:
+        friend class Batch2D;
+
+        struct ContextData;
+        explicit Batch2DContext(ContextData* data);
+
+        Owned<ContextData> m_pimpl;
+    };
+
+    /**
+     * Collects quads between begin_batch() and end_batch() and radix sorts them by layer, then depth, shader and texture.
+     * Each run of quads sharing a shader and at most TextureArraySize textures is drawn with a single call.
+     * Quads may be drawn from several threads at once through get_thread_context(), the Batch2D's own draw_quad()
+     * and setters use a context reserved for the thread that owns it.
+     */
     class Batch2D
     {
     public:
@@ -15,11 +66,46 @@ namespace app::gfx
         void init(Renderer& renderer);
         void shutdown();
 
+        /* Setters */
+
+        /* Applies to quads drawn afterwards. Lower layers are drawn first. */
+        void set_layer(i16 layer);
+        /* Applies to quads drawn afterwards. Custom shaders must take Batch2D's vertex layout and one texture array set. */
+        void set_shader(Shader* shader);
+        /* Applies to quads drawn afterwards. Within their layer, y-sorted quads are drawn in order of their bottom edge's y. */
+        void set_y_sorted(bool is_y_sorted);
+
+        /* Getters */
+
+        auto get_quad_count() const -> u32;
+        /* The calling thread's context, created on its first call. Only that first call takes a lock. */
+        auto get_thread_context() -> Batch2DContext&;
+        /* Draw calls issued by the last flush(). */
+        auto get_draw_call_count() const -> u32;
+        /* Milliseconds the last end_batch() spent sorting. */
+        auto get_sort_time() const -> f32;
+
+        /* Commands */
+
+        /* Clears every context. No thread may be drawing. */
         void begin_batch();
+        /* Merges and sorts the quads drawn since begin_batch() and writes their instances for the GPU. No thread may be drawing. */
         void end_batch();
         void flush();
 
         void draw_quad(const glm::vec2& position, const glm::vec2& size, const glm::vec4& color);
+        void draw_quad(const glm::vec2& position, const glm::vec2& size, Texture* texture, const glm::vec4& tint = glm::vec4(1.0f));
+        /* Draws the min_uv..max_uv rectangle of a texture, such as one sprite of an atlas, rotated in radians about its centre. */
+        void draw_quad(const glm::vec2& position,
+                       const glm::vec2& size,
+                       Texture* texture,
+                       const glm::vec2& min_uv,
+                       const glm::vec2& max_uv,
+                       const glm::vec4& tint = glm::vec4(1.0f),
+                       f32 rotation = 0.0f);
+
+    private:
+        auto create_context() -> Batch2DContext&;
 
     private:
         struct BatchData;
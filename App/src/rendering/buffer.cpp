@@ -1,6 +1,7 @@
 #include "buffer.hpp"
 
 #include "device.hpp"
+#include "buffer_pool.hpp"
 
 #include <vulkan/vulkan.hpp>
 #include <vk_mem_alloc.h>
@@ -15,6 +16,15 @@ namespace app::gfx
         VmaAllocation allocation{};
         sizet size = 0;
         bool isMappable = false;
+        // Set for the lifetime of persistently mapped buffers
+        byte* mappedData = nullptr;
+
+        // Buffers from a pool view a range of one of its blocks, sharing the block's buffer and allocation
+        BufferPool* pool = nullptr;
+        u32 poolBlock = 0;
+        VmaVirtualAllocation poolAllocation{};
+        sizet offset = 0;
+        u32 elementOffset = 0;
     };
 
     Buffer::Buffer(Device* device) : m_pimpl(new BufferPimpl)
@@ -27,7 +37,7 @@ namespace app::gfx
         destroy();
     }
 
-    void Buffer::init(sizet size, vk::BufferUsageFlags usage, bool force_mappable)
+    void Buffer::init(sizet size, vk::BufferUsageFlags usage, BufferMemory memory)
     {
         destroy();
 
@@ -41,16 +51,49 @@ namespace app::gfx
 
         VmaAllocationCreateInfo alloc_info{};
         alloc_info.usage = VMA_MEMORY_USAGE_AUTO;
-        if (force_mappable || usage & vk::BufferUsageFlagBits::eTransferSrc)
+        if (memory != BufferMemory::DeviceLocal || usage & vk::BufferUsageFlagBits::eTransferSrc)
         {
             alloc_info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+            if (memory == BufferMemory::PersistentlyMapped)
+            {
+                alloc_info.flags |= VMA_ALLOCATION_CREATE_MAPPED_BIT;
+            }
             m_pimpl->isMappable = true;
         }
+        else
+        {
+            buffer_info.usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+            m_pimpl->isMappable = false;
+        }
 
         VkBuffer vkBuffer = nullptr;
-        vmaCreateBuffer(allocator, &buffer_info, &alloc_info, &vkBuffer, &m_pimpl->allocation, nullptr);
+        VmaAllocationInfo allocation_info{};
+        vmaCreateBuffer(allocator, &buffer_info, &alloc_info, &vkBuffer, &m_pimpl->allocation, &allocation_info);
 
         m_pimpl->buffer = vkBuffer;
+        m_pimpl->mappedData = static_cast<byte*>(allocation_info.pMappedData);
+    }
+
+    void Buffer::init_pool_range(BufferPool* pool,
+                                 u32 block_index,
+                                 VmaVirtualAllocation allocation,
+                                 const Buffer& block,
+                                 sizet offset,
+                                 sizet size)
+    {
+        destroy();
+
+        m_pimpl->pool = pool;
+        m_pimpl->poolBlock = block_index;
+        m_pimpl->poolAllocation = allocation;
+
+        m_pimpl->buffer = block.m_pimpl->buffer;
+        m_pimpl->allocation = block.m_pimpl->allocation;
+        m_pimpl->isMappable = block.m_pimpl->isMappable;
+        m_pimpl->mappedData = block.m_pimpl->mappedData != nullptr ? block.m_pimpl->mappedData + offset : nullptr;
+        m_pimpl->offset = offset;
+        m_pimpl->elementOffset = static_cast<u32>(offset / pool->get_element_size());
+        m_pimpl->size = size;
     }
 
     void Buffer::destroy()
@@ -60,12 +103,28 @@ namespace app::gfx
             return;
         }
 
-        auto allocator = m_pimpl->device->get_allocator();
+        if (m_pimpl->pool != nullptr)
+        {
+            // The block belongs to the pool, only the range is returned
+            m_pimpl->pool->free(m_pimpl->poolBlock, m_pimpl->poolAllocation);
 
-        vmaDestroyBuffer(allocator, m_pimpl->buffer, m_pimpl->allocation);
+            m_pimpl->pool = nullptr;
+            m_pimpl->poolAllocation = nullptr;
+            m_pimpl->offset = 0;
+            m_pimpl->elementOffset = 0;
+        }
+        else
+        {
+            // Frames in flight may still read the buffer
+            m_pimpl->device->defer_destroy([allocator = m_pimpl->device->get_allocator(),
+                                            buffer = m_pimpl->buffer,
+                                            allocation = m_pimpl->allocation]
+                                           { vmaDestroyBuffer(allocator, buffer, allocation); });
+        }
 
         m_pimpl->buffer = nullptr;
         m_pimpl->allocation = nullptr;
+        m_pimpl->mappedData = nullptr;
         m_pimpl->size = 0;
     }
 
@@ -74,28 +133,83 @@ namespace app::gfx
         return m_pimpl->buffer;
     }
 
+    auto Buffer::get_offset() const -> sizet
+    {
+        return m_pimpl->offset;
+    }
+
+    auto Buffer::get_element_offset() const -> u32
+    {
+        return m_pimpl->elementOffset;
+    }
+
     auto Buffer::get_size() const -> sizet
     {
         return m_pimpl->size;
     }
 
+    bool Buffer::is_mappable() const
+    {
+        return m_pimpl->isMappable;
+    }
+
+    auto Buffer::get_mapped_data() const -> void*
+    {
+        ASSERT(m_pimpl->mappedData != nullptr);
+        return m_pimpl->mappedData;
+    }
+
     void Buffer::write_data(sizet offset, sizet size, const void* data)
     {
-        if (m_pimpl->isMappable)
+        ASSERT(offset + size <= m_pimpl->size);
+
+        if (m_pimpl->mappedData != nullptr)
+        {
+            std::memcpy(m_pimpl->mappedData + offset, data, size);
+            flush_range(offset, size);
+        }
+        else if (m_pimpl->isMappable)
         {
             auto allocator = m_pimpl->device->get_allocator();
 
             byte* mapped_ptr = nullptr;
             vmaMapMemory(allocator, m_pimpl->allocation, reinterpret_cast<void**>(&mapped_ptr));
-            std::memcpy(mapped_ptr + offset, data, size);
+            std::memcpy(mapped_ptr + m_pimpl->offset + offset, data, size);
+            vmaFlushAllocation(allocator, m_pimpl->allocation, m_pimpl->offset + offset, size);
             vmaUnmapMemory(allocator, m_pimpl->allocation);
         }
         else
         {
-            // Staging Buffer
-
-            // #TODO: Upload using staging buffer
+            m_pimpl->device->upload_to_buffer(m_pimpl->buffer, m_pimpl->offset + offset, size, data);
         }
     }
 
+    auto Buffer::stage_write(sizet offset, sizet size) -> void*
+    {
+        ASSERT(!m_pimpl->isMappable);
+        ASSERT(offset + size <= m_pimpl->size);
+
+        return m_pimpl->device->stage_buffer_upload(m_pimpl->buffer, m_pimpl->offset + offset, size);
+    }
+
+    auto Buffer::map() -> void*
+    {
+        ASSERT(m_pimpl->isMappable);
+
+        byte* mapped_ptr = nullptr;
+        vmaMapMemory(m_pimpl->device->get_allocator(), m_pimpl->allocation, reinterpret_cast<void**>(&mapped_ptr));
+        return mapped_ptr + m_pimpl->offset;
+    }
+
+    void Buffer::unmap()
+    {
+        vmaUnmapMemory(m_pimpl->device->get_allocator(), m_pimpl->allocation);
+    }
+
+    void Buffer::flush_range(sizet offset, sizet size)
+    {
+        ASSERT(m_pimpl->isMappable);
+        vmaFlushAllocation(m_pimpl->device->get_allocator(), m_pimpl->allocation, m_pimpl->offset + offset, size);
+    }
+
 }
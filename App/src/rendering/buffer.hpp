@@ -3,10 +3,22 @@
 #include "core/core.hpp"
 
 #include <vulkan/vulkan.hpp>
+#include <vk_mem_alloc.h>
 
 namespace app::gfx
 {
     class Device;
+    class BufferPool;
+
+    enum class BufferMemory : u8
+    {
+        // Device local, written through the device's staging ring
+        DeviceLocal,
+        // Host visible, mapped for each write
+        Mappable,
+        // Host visible and mapped for the buffer's whole lifetime, written in place through get_mapped_data()
+        PersistentlyMapped,
+    };
 
     class Buffer
     {
@@ -16,18 +28,53 @@ namespace app::gfx
 
         /* Initialization/Destruction */
 
-        void init(sizet size, vk::BufferUsageFlags usage, bool force_mappable = false);
+        /* Transfer source buffers are always at least Mappable. */
+        void init(sizet size, vk::BufferUsageFlags usage, BufferMemory memory = BufferMemory::DeviceLocal);
         void destroy();
 
         /* Getters */
 
+        /* For buffers from a BufferPool, the pool block the buffer's range lives in. */
         auto get_buffer() const -> vk::Buffer;
+        /* Byte offset of the buffer's range in get_buffer(), 0 unless the buffer is from a BufferPool. */
+        auto get_offset() const -> sizet;
+        /* get_offset() in elements of the pool's element size, used to address the range without rebinding the block. */
+        auto get_element_offset() const -> u32;
 
         auto get_size() const -> sizet;
 
+        bool is_mappable() const;
+
+        /**
+         * Persistently mapped buffers only. May be written from any thread, after which flush_range() must be called on the
+         * written bytes before the GPU reads them.
+         */
+        auto get_mapped_data() const -> void*;
+
         /* Commands */
 
+        /* Device local buffers are updated by a copy that runs before the current frame's commands. */
         void write_data(sizet offset, sizet size, const void* data);
+        /* Device local buffers only. Returns staging memory for size bytes at offset, see Device::stage_buffer_upload(). */
+        auto stage_write(sizet offset, sizet size) -> void*;
+
+        /* Only valid for mappable buffers. The pointer may be written from any thread until unmap(). */
+        auto map() -> void*;
+        void unmap();
+
+        /* Makes host writes to a range of a mappable buffer visible to the GPU. Does nothing for host coherent memory. */
+        void flush_range(sizet offset, sizet size);
+
+    private:
+        friend class BufferPool;
+
+        /* Makes the buffer a view of a range of one of the pool's blocks. */
+        void init_pool_range(BufferPool* pool,
+                             u32 block_index,
+                             VmaVirtualAllocation allocation,
+                             const Buffer& block,
+                             sizet offset,
+                             sizet size);
 
     private:
         struct BufferPimpl;
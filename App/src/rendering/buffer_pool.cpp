@@ -0,0 +1,130 @@
+#include "buffer_pool.hpp"
+
+#include "device.hpp"
+
+#include <algorithm>
+
+namespace app::gfx
+{
+    struct BufferPool::BufferPoolPimpl
+    {
+        Device* device = nullptr;
+
+        sizet elementSize = 0;
+        sizet blockSize = 0;
+        vk::BufferUsageFlags usage{};
+        BufferMemory memory = BufferMemory::DeviceLocal;
+
+        struct Block
+        {
+            Owned<Buffer> BlockBuffer = nullptr;
+            VmaVirtualBlock Allocator{};
+            u32 AllocationCount = 0;
+        };
+        std::vector<Block> blocks{};
+    };
+
+    BufferPool::BufferPool(Device* device) : m_pimpl(new BufferPoolPimpl)
+    {
+        m_pimpl->device = device;
+    }
+
+    BufferPool::~BufferPool()
+    {
+        destroy();
+    }
+
+    void BufferPool::init(sizet element_size, sizet block_size, vk::BufferUsageFlags usage, BufferMemory memory)
+    {
+        ASSERT(element_size > 0 && (element_size & (element_size - 1)) == 0);
+
+        destroy();
+
+        m_pimpl->elementSize = element_size;
+        m_pimpl->blockSize = block_size;
+        m_pimpl->usage = usage;
+        m_pimpl->memory = memory;
+    }
+
+    void BufferPool::destroy()
+    {
+        for (auto& block : m_pimpl->blocks)
+        {
+            ASSERT(block.AllocationCount == 0);
+
+            // Queued after the frees of the block's ranges, which still refer to it
+            m_pimpl->device->defer_destroy(
+                [allocator = block.Allocator]
+                {
+                    vmaClearVirtualBlock(allocator);
+                    vmaDestroyVirtualBlock(allocator);
+                });
+            block.BlockBuffer = nullptr;
+        }
+        m_pimpl->blocks.clear();
+    }
+
+    auto BufferPool::get_element_size() const -> sizet
+    {
+        return m_pimpl->elementSize;
+    }
+
+    auto BufferPool::get_block_count() const -> u32
+    {
+        return static_cast<u32>(m_pimpl->blocks.size());
+    }
+
+    auto BufferPool::allocate(sizet size) -> Shared<Buffer>
+    {
+        VmaVirtualAllocationCreateInfo alloc_info{};
+        alloc_info.size = size;
+        alloc_info.alignment = m_pimpl->elementSize;
+
+        VmaVirtualAllocation allocation{};
+        VkDeviceSize offset = 0;
+
+        auto block_index = static_cast<u32>(m_pimpl->blocks.size());
+        for (u32 i = 0; i < m_pimpl->blocks.size(); ++i)
+        {
+            if (vmaVirtualAllocate(m_pimpl->blocks[i].Allocator, &alloc_info, &allocation, &offset) == VK_SUCCESS)
+            {
+                block_index = i;
+                break;
+            }
+        }
+
+        if (block_index == m_pimpl->blocks.size())
+        {
+            // Every block is full, so add one big enough for the buffer. Blocks start aligned, so any element size fits.
+            auto& block = m_pimpl->blocks.emplace_back();
+
+            VmaVirtualBlockCreateInfo block_info{};
+            block_info.size = std::max(m_pimpl->blockSize, size);
+            vmaCreateVirtualBlock(&block_info, &block.Allocator);
+
+            block.BlockBuffer = CreateOwned<Buffer>(m_pimpl->device);
+            block.BlockBuffer->init(block_info.size, m_pimpl->usage, m_pimpl->memory);
+
+            const auto result = vmaVirtualAllocate(block.Allocator, &alloc_info, &allocation, &offset);
+            ASSERT(result == VK_SUCCESS);
+            UNUSED(result);
+        }
+
+        auto& block = m_pimpl->blocks[block_index];
+        ++block.AllocationCount;
+
+        auto buffer = CreateShared<Buffer>(m_pimpl->device);
+        buffer->init_pool_range(this, block_index, allocation, *block.BlockBuffer, offset, size);
+        return buffer;
+    }
+
+    void BufferPool::free(u32 block_index, VmaVirtualAllocation allocation)
+    {
+        auto& block = m_pimpl->blocks[block_index];
+        --block.AllocationCount;
+
+        // Frames in flight may still read the range, so it is only reused once they finish
+        m_pimpl->device->defer_destroy([allocator = block.Allocator, allocation] { vmaVirtualFree(allocator, allocation); });
+    }
+
+}
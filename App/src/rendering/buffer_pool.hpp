@@ -0,0 +1,51 @@
+#pragma once
+
+#include "core/core.hpp"
+
+#include "buffer.hpp"
+
+#include <vulkan/vulkan.hpp>
+#include <vk_mem_alloc.h>
+
+#include <vector>
+
+namespace app::gfx
+{
+    class Device;
+
+    /**
+     * Hands out buffers carved from a few large blocks, so thousands of small buffers cost a handful of allocations.
+     * Ranges are placed by a TLSF virtual allocator and aligned to the element size, so the renderer can bind a block once and
+     * address each buffer by its element offset. The pool must outlive the buffers it allocates.
+     */
+    class BufferPool
+    {
+    public:
+        explicit BufferPool(Device* device);
+        ~BufferPool();
+
+        /* Initialisation/Destruction */
+
+        /* element_size must be a power of two. Blocks are created as needed, block_size bytes or larger for buffers that would not fit. */
+        void init(sizet element_size, sizet block_size, vk::BufferUsageFlags usage, BufferMemory memory = BufferMemory::DeviceLocal);
+        void destroy();
+
+        /* Getters */
+
+        auto get_element_size() const -> sizet;
+        auto get_block_count() const -> u32;
+
+        /* Commands */
+
+        auto allocate(sizet size) -> Shared<Buffer>;
+
+    private:
+        friend class Buffer;
+
+        void free(u32 block_index, VmaVirtualAllocation allocation);
+
+    private:
+        struct BufferPoolPimpl;
+        Owned<BufferPoolPimpl> m_pimpl;
+    };
+}
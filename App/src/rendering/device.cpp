@@ -1,22 +1,105 @@
 #include "device.hpp"
 
 #include "buffer.hpp"
+#include "texture.hpp"
 
 #include <vulkan/vulkan.hpp>
 #define VMA_IMPLEMENTATION
 #include <vk_mem_alloc.h>
 
+#include <algorithm>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+
 namespace app::gfx
 {
-    constexpr u32 FramesInFlight = 2;
+    // Descriptor sets in each pool a frame allocates transient bindings from, a frame chains another pool when one runs out
+    constexpr u32 MaxFrameSets = 256;
+
+    // Bytes of the staging ring each frame can fill, larger uploads get a staging buffer of their own
+    constexpr sizet StagingRegionSize = 16 * 1024 * 1024;
+    constexpr sizet StagingAlignment = 16;
+
+    // Size of each upload batch staging arena chunk, larger uploads get a chunk of their own size
+    constexpr sizet StagingArenaChunkSize = 8 * 1024 * 1024;
+
+    // Relative to the working directory, written at shutdown and read back by the next launch
+    constexpr const char* PipelineCacheFile = "pipeline_cache.bin";
+
+    struct StagingBuffer
+    {
+        vk::Buffer buffer{};
+        VmaAllocation allocation{};
+        byte* mapped = nullptr;
+    };
+
+    struct StagingChunk
+    {
+        StagingBuffer Staging{};
+        sizet Size = 0;
+        sizet Used = 0;
+        // Upload batch that last staged from the chunk, reusable once it has completed
+        u64 LastUse = 0;
+    };
+
+    struct UploadBatch
+    {
+        vk::CommandBuffer Cmd{};
+        // Signalled on the upload timeline once Cmd has finished
+        u64 Value = 0;
+    };
+
+    // Where an upload's data is staged and the command buffer its copy is recorded into
+    struct StagingAllocation
+    {
+        vk::CommandBuffer Cmd{};
+        vk::Buffer Buffer{};
+        sizet Offset = 0;
+        byte* Mapped = nullptr;
+        // The copy runs on the transfer queue, which must release what it writes to the graphics queue
+        bool IsOnTransferQueue = false;
+    };
+
+    // Resources an upload batch on the transfer queue released, acquired by the graphics queue once the batch has completed
+    struct OwnershipTransfer
+    {
+        u64 Value = 0;
+        std::vector<vk::BufferMemoryBarrier> Buffers{};
+        std::vector<vk::ImageMemoryBarrier> Images{};
+    };
 
     struct Frame
     {
         vk::CommandBuffer cmd{};
 
+        // Buffer copies, submitted ahead of cmd in the frame's submission
+        vk::CommandBuffer uploadCmd{};
+        bool isRecordingUploads = false;
+        // Bytes used of the frame's staging ring region
+        sizet stagingUsed = 0;
+        // Uploads that did not fit the region, released once the frame's fence has signalled
+        std::vector<StagingBuffer> overflowStaging{};
+
         vk::Semaphore imageReadySemaphore{};
         vk::Semaphore renderDoneSemaphore{};
         vk::Fence cmdFence{};
+        // Frame number last submitted in this slot, complete once cmdFence has signalled
+        u64 submittedFrameNumber = 0;
+        // Upload batch whose released resources uploadCmd acquires, waited on by the frame's submission
+        u64 acquiredUploadValue = 0;
+
+        // Reset together once the frame's fence has signalled, allocation moves on to the next pool when one is full
+        std::vector<vk::DescriptorPool> descriptorPools{};
+        u32 descriptorPoolIndex = 0;
+    };
+
+    struct PendingDestroy
+    {
+        // Last frame and upload batch that may use the resource
+        u64 FrameNumber = 0;
+        u64 UploadValue = 0;
+        std::function<void()> Destroy{};
     };
 
     struct BackBuffer
@@ -35,17 +118,50 @@ namespace app::gfx
 
         u32 graphicsQueueFamily = 0;
         vk::Queue graphicsQueue{};
+        // The graphics family and queue when the device has no dedicated transfer family
+        u32 transferQueueFamily = 0;
+        vk::Queue transferQueue{};
+        bool hasTransferQueue = false;
 
         vk::DescriptorPool descriptorPool{};
         vk::DescriptorSetLayout textureSetLayout{};
+        vk::DescriptorSetLayout textureArraySetLayout{};
 
         vk::Sampler nearestSampler{};
         vk::Sampler linearSampler{};
 
         vk::CommandPool cmdPool{};
+        vk::CommandPool transferCmdPool{};
+
+        vk::PipelineCache pipelineCache{};
+
+        // One region of StagingRegionSize per frame in flight, mapped for its whole lifetime
+        StagingBuffer stagingRing{};
 
         std::array<Frame, FramesInFlight> frames{};
         u32 frameIndex = 0;
+        u64 frameNumber = 0;
+        // Between new_frame() waiting on the frame's fence and flush_frame() submitting it
+        bool isRecordingFrame = false;
+
+        // In frame number order, as frames only move forward
+        std::deque<PendingDestroy> pendingDestroys{};
+
+        // Upload batches signal increasing values on the timeline, so one value tells which batches have finished
+        vk::Semaphore uploadTimeline{};
+        u64 uploadValue = 0;
+        std::vector<UploadBatch> uploadBatches{};
+        std::vector<StagingChunk> stagingArena{};
+        // Index into uploadBatches of the batch being recorded
+        u32 batchIndex = 0;
+        bool isRecordingBatch = false;
+
+        // Signalled with the frame number by each frame's submission, so batches on the transfer queue can wait for earlier frames
+        vk::Semaphore frameTimeline{};
+        u64 lastSubmittedFrameNumber = 0;
+        OwnershipTransfer batchReleases{};
+        // In upload batch order
+        std::deque<OwnershipTransfer> pendingAcquires{};
 
         auto get_frame() -> Frame&
         {
@@ -215,7 +331,7 @@ namespace app::gfx
             }
         }
 
-        auto create_staging_buffer(VmaAllocator allocator, sizet size, const void* data) -> std::pair<vk::Buffer, VmaAllocation>
+        auto create_mapped_staging_buffer(VmaAllocator allocator, sizet size) -> StagingBuffer
         {
             VkBufferCreateInfo buffer_info = vk::BufferCreateInfo();
             buffer_info.size = size;
@@ -223,20 +339,314 @@ namespace app::gfx
 
             VmaAllocationCreateInfo alloc_info{};
             alloc_info.usage = VMA_MEMORY_USAGE_AUTO;
-            alloc_info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+            alloc_info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
 
             VkBuffer vkBuffer = nullptr;
-            VmaAllocation allocation = nullptr;
-            vmaCreateBuffer(allocator, &buffer_info, &alloc_info, &vkBuffer, &allocation, nullptr);
+            VmaAllocationInfo allocation_info{};
+            StagingBuffer staging{};
+            vmaCreateBuffer(allocator, &buffer_info, &alloc_info, &vkBuffer, &staging.allocation, &allocation_info);
+
+            staging.buffer = vkBuffer;
+            staging.mapped = static_cast<byte*>(allocation_info.pMappedData);
+            return staging;
+        }
+
+        auto create_frame_descriptor_pool(vk::Device device) -> vk::DescriptorPool
+        {
+            const vk::DescriptorPoolSize pool_size{ vk::DescriptorType::eCombinedImageSampler, MaxFrameSets * TextureArraySize };
+            vk::DescriptorPoolCreateInfo pool_info{};
+            pool_info.setMaxSets(MaxFrameSets);
+            pool_info.setPoolSizes(pool_size);
+            return device.createDescriptorPool(pool_info);
+        }
+
+        void release_overflow_staging(Device::DevicePimpl& pimpl, Frame& frame)
+        {
+            for (const auto& staging : frame.overflowStaging)
+            {
+                vmaDestroyBuffer(pimpl.allocator, staging.buffer, staging.allocation);
+            }
+            frame.overflowStaging.clear();
+        }
+
+        // Cache data written by another driver or device is ignored, so pipelines are compiled from scratch instead
+        auto load_pipeline_cache_data(vk::PhysicalDevice physical_device) -> std::vector<byte>
+        {
+            std::ifstream file(PipelineCacheFile, std::ios::ate | std::ios::binary);
+            if (!file.is_open())
+            {
+                return {};
+            }
 
-            void* mapped_data = nullptr;
-            vmaMapMemory(allocator, allocation, &mapped_data);
-            std::memcpy(mapped_data, data, size);
-            vmaUnmapMemory(allocator, allocation);
+            std::vector<byte> data(static_cast<sizet>(file.tellg()));
+            file.seekg(0);
+            file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
 
-            return { vkBuffer, allocation };
+            VkPipelineCacheHeaderVersionOne header{};
+            if (!file || data.size() < sizeof(header))
+            {
+                LOG_WARN("Device - Pipeline cache <{}> is truncated, ignoring it", PipelineCacheFile);
+                return {};
+            }
+            std::memcpy(&header, data.data(), sizeof(header));
+
+            const auto properties = physical_device.getProperties();
+            const bool is_compatible = header.headerSize >= sizeof(header) &&
+                                       header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+                                       header.vendorID == properties.vendorID && header.deviceID == properties.deviceID &&
+                                       std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID.data(), VK_UUID_SIZE) == 0;
+            if (!is_compatible)
+            {
+                LOG_WARN("Device - Pipeline cache <{}> was written by another device or driver, ignoring it", PipelineCacheFile);
+                return {};
+            }
+
+            return data;
+        }
+
+        void save_pipeline_cache(Device::DevicePimpl& pimpl)
+        {
+            const auto data = pimpl.device.getPipelineCacheData(pimpl.pipelineCache);
+            if (data.empty())
+            {
+                return;
+            }
+
+            // Written aside and then moved over the old cache, so a crash mid-write cannot leave a torn file
+            const std::filesystem::path path = PipelineCacheFile;
+            auto temp_path = path;
+            temp_path += ".tmp";
+            {
+                std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+                file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+                if (!file)
+                {
+                    LOG_WARN("Device - Failed to write pipeline cache <{}>!", temp_path.string());
+                    return;
+                }
+            }
+
+            std::error_code error{};
+            std::filesystem::rename(temp_path, path, error);
+            if (error)
+            {
+                LOG_WARN("Device - Failed to replace pipeline cache <{}>: {}", path.string(), error.message());
+            }
+        }
+
+        void run_pending_destroys(Device::DevicePimpl& pimpl, u64 completed_frame_number, u64 completed_upload_value)
+        {
+            // A later frame still records acquire barriers on what batches not yet acquired wrote, so their resources stay alive
+            // until then. The acquire moves such destroys to its frame.
+            if (!pimpl.pendingAcquires.empty())
+            {
+                completed_upload_value = std::min(completed_upload_value, pimpl.pendingAcquires.front().Value - 1);
+            }
+
+            auto& pending = pimpl.pendingDestroys;
+            while (!pending.empty() && pending.front().FrameNumber <= completed_frame_number &&
+                   pending.front().UploadValue <= completed_upload_value)
+            {
+                pending.front().Destroy();
+                pending.pop_front();
+            }
+        }
+
+        // Stages that read buffers written by uploads
+        const vk::PipelineStageFlags BufferReadStages = vk::PipelineStageFlagBits::eVertexInput |
+                                                        vk::PipelineStageFlagBits::eVertexShader |
+                                                        vk::PipelineStageFlagBits::eFragmentShader;
+
+        // Textures can be sampled from both vertex and fragment shaders
+        const vk::PipelineStageFlags ShaderReadStages = vk::PipelineStageFlagBits::eVertexShader | vk::PipelineStageFlagBits::eFragmentShader;
+
+        // Stages of a frame that may touch resources acquired from the transfer queue
+        const vk::PipelineStageFlags AcquireStages = BufferReadStages | vk::PipelineStageFlagBits::eTransfer;
+
+        // prior_stages are the stages of earlier submissions on the same queue that may use the buffers about to be written
+        void begin_upload_cmd(vk::CommandBuffer cmd, vk::PipelineStageFlags prior_stages)
+        {
+            cmd.reset();
+            cmd.begin(vk::CommandBufferBeginInfo{ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+
+            vk::MemoryBarrier barrier{};
+            barrier.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite);
+            barrier.setDstAccessMask(vk::AccessFlagBits::eTransferWrite);
+            cmd.pipelineBarrier(prior_stages, vk::PipelineStageFlagBits::eTransfer, {}, barrier, {}, {});
+        }
+
+        void end_upload_cmd(vk::CommandBuffer cmd)
+        {
+            vk::MemoryBarrier barrier{};
+            barrier.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite);
+            barrier.setDstAccessMask(vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eIndexRead |
+                                     vk::AccessFlagBits::eUniformRead | vk::AccessFlagBits::eShaderRead);
+            cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, BufferReadStages, {}, barrier, {}, {});
+
+            cmd.end();
         }
 
+        void begin_frame_uploads(Device::DevicePimpl& pimpl, Frame& frame)
+        {
+            // Uploads made before new_frame() may reach a frame slot the GPU is still using
+            if (!pimpl.isRecordingFrame)
+            {
+                UNUSED(pimpl.device.waitForFences(frame.cmdFence, true, u64_max));
+            }
+
+            release_overflow_staging(pimpl, frame);
+            frame.stagingUsed = 0;
+
+            begin_upload_cmd(frame.uploadCmd, BufferReadStages | vk::PipelineStageFlagBits::eTransfer);
+            frame.acquiredUploadValue = 0;
+            frame.isRecordingUploads = true;
+        }
+
+        void end_frame_uploads(Device::DevicePimpl& pimpl, Frame& frame)
+        {
+            // Staging memory may not be host coherent
+            const sizet region_offset = StagingRegionSize * pimpl.frameIndex;
+            vmaFlushAllocation(pimpl.allocator, pimpl.stagingRing.allocation, region_offset, frame.stagingUsed);
+            for (const auto& staging : frame.overflowStaging)
+            {
+                vmaFlushAllocation(pimpl.allocator, staging.allocation, 0, VK_WHOLE_SIZE);
+            }
+
+            end_upload_cmd(frame.uploadCmd);
+            frame.isRecordingUploads = false;
+        }
+
+        void acquire_completed_uploads(Device::DevicePimpl& pimpl, Frame& frame)
+        {
+            if (pimpl.pendingAcquires.empty())
+            {
+                return;
+            }
+
+            // Only finished batches are acquired, so frames never stall behind the transfer queue
+            const u64 completed_value = pimpl.device.getSemaphoreCounterValue(pimpl.uploadTimeline);
+            const u64 first_acquired_value = pimpl.pendingAcquires.front().Value;
+            if (first_acquired_value > completed_value)
+            {
+                return;
+            }
+
+            while (!pimpl.pendingAcquires.empty() && pimpl.pendingAcquires.front().Value <= completed_value)
+            {
+                if (!frame.isRecordingUploads)
+                {
+                    begin_frame_uploads(pimpl, frame);
+                }
+
+                // An acquire repeats its release, with the access masks on the graphics side
+                auto& transfer = pimpl.pendingAcquires.front();
+                for (auto& barrier : transfer.Buffers)
+                {
+                    barrier.setSrcAccessMask({});
+                    barrier.setDstAccessMask(vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eIndexRead |
+                                             vk::AccessFlagBits::eUniformRead | vk::AccessFlagBits::eShaderRead |
+                                             vk::AccessFlagBits::eTransferWrite);
+                }
+                for (auto& barrier : transfer.Images)
+                {
+                    barrier.setSrcAccessMask({});
+                    barrier.setDstAccessMask(vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eTransferWrite);
+                }
+                frame.uploadCmd.pipelineBarrier(AcquireStages, AcquireStages, {}, {}, transfer.Buffers, transfer.Images);
+
+                frame.acquiredUploadValue = transfer.Value;
+                pimpl.pendingAcquires.pop_front();
+            }
+
+            // Destroys queued while an acquired batch was in flight may name what the barriers above touch, so they also wait for
+            // the frame submitting them. Upload values only grow along the queue, so the search stops at the first older destroy.
+            const u64 acquire_frame_number = pimpl.isRecordingFrame ? pimpl.frameNumber : pimpl.frameNumber + 1;
+            auto& pending = pimpl.pendingDestroys;
+            for (auto it = pending.rbegin(); it != pending.rend() && it->UploadValue >= first_acquired_value; ++it)
+            {
+                it->FrameNumber = std::max(it->FrameNumber, acquire_frame_number);
+            }
+        }
+
+        auto align_staging(sizet offset) -> sizet
+        {
+            return (offset + StagingAlignment - 1) & ~(StagingAlignment - 1);
+        }
+
+        auto allocate_frame_staging(Device::DevicePimpl& pimpl, sizet size) -> StagingAllocation
+        {
+            auto& frame = pimpl.get_frame();
+            if (!frame.isRecordingUploads)
+            {
+                begin_frame_uploads(pimpl, frame);
+            }
+
+            // The copy may write what a finished batch released, which the frame must own first
+            acquire_completed_uploads(pimpl, frame);
+
+            StagingBuffer staging = pimpl.stagingRing;
+            sizet staging_offset = align_staging(frame.stagingUsed);
+            if (staging_offset + size <= StagingRegionSize)
+            {
+                frame.stagingUsed = staging_offset + size;
+                staging_offset += StagingRegionSize * pimpl.frameIndex;
+            }
+            else
+            {
+                staging = frame.overflowStaging.emplace_back(create_mapped_staging_buffer(pimpl.allocator, size));
+                staging_offset = 0;
+            }
+
+            return { frame.uploadCmd, staging.buffer, staging_offset, staging.mapped + staging_offset, false };
+        }
+
+        auto allocate_batch_staging(Device::DevicePimpl& pimpl, sizet size) -> StagingAllocation
+        {
+            const auto& batch = pimpl.uploadBatches[pimpl.batchIndex];
+            const u64 completed_value = pimpl.device.getSemaphoreCounterValue(pimpl.uploadTimeline);
+
+            StagingChunk* chunk = nullptr;
+            for (auto& candidate : pimpl.stagingArena)
+            {
+                // Chunks of finished batches start over, chunks of the open batch carry on where they stopped
+                if (candidate.LastUse != batch.Value && candidate.LastUse <= completed_value)
+                {
+                    candidate.Used = 0;
+                }
+                else if (candidate.LastUse != batch.Value)
+                {
+                    continue;
+                }
+
+                if (align_staging(candidate.Used) + size <= candidate.Size)
+                {
+                    chunk = &candidate;
+                    break;
+                }
+            }
+
+            if (chunk == nullptr)
+            {
+                chunk = &pimpl.stagingArena.emplace_back();
+                chunk->Size = std::max(StagingArenaChunkSize, size);
+                chunk->Staging = create_mapped_staging_buffer(pimpl.allocator, chunk->Size);
+            }
+
+            const sizet staging_offset = align_staging(chunk->Used);
+            chunk->Used = staging_offset + size;
+            chunk->LastUse = batch.Value;
+
+            return { batch.Cmd, chunk->Staging.buffer, staging_offset, chunk->Staging.mapped + staging_offset, pimpl.hasTransferQueue };
+        }
+
+        auto allocate_staging(Device::DevicePimpl& pimpl, sizet size) -> StagingAllocation
+        {
+            return pimpl.isRecordingBatch ? allocate_batch_staging(pimpl, size) : allocate_frame_staging(pimpl, size);
+        }
+
+        // Every image is a single colour layer and mip
+        const vk::ImageSubresourceRange ColorSubresourceRange{ vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 };
+
         void transition_image(vk::CommandBuffer cmd,
                               vk::Image image,
                               vk::ImageLayout oldLayout,
@@ -246,24 +656,67 @@ namespace app::gfx
                               vk::PipelineStageFlags srcStage,
                               vk::PipelineStageFlags dstStage)
         {
-            vk::ImageSubresourceRange range{};
-            range.setAspectMask(vk::ImageAspectFlagBits::eColor);
-            range.setBaseArrayLayer(0);
-            range.setLayerCount(1);
-            range.setBaseMipLevel(0);
-            range.setLevelCount(1);
-
             vk::ImageMemoryBarrier barrier{};
             barrier.setImage(image);
             barrier.setOldLayout(oldLayout);
             barrier.setNewLayout(newLayout);
-            barrier.setSubresourceRange(range);
+            barrier.setSubresourceRange(ColorSubresourceRange);
             barrier.setSrcAccessMask(srcAccess);
             barrier.setDstAccessMask(dstAccess);
 
             cmd.pipelineBarrier(srcStage, dstStage, {}, {}, {}, barrier);
         }
 
+        // The image must be in the transfer destination layout
+        void record_buffer_to_image_copy(vk::CommandBuffer cmd,
+                                         vk::Buffer src_buffer,
+                                         sizet src_offset,
+                                         vk::Image image,
+                                         vk::Offset3D region_offset,
+                                         vk::Extent3D region_extent)
+        {
+            vk::BufferImageCopy region{};
+            region.bufferOffset = src_offset;
+            region.imageOffset = region_offset;
+            region.imageExtent = region_extent;
+            region.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+            region.imageSubresource.baseArrayLayer = 0;
+            region.imageSubresource.layerCount = 1;
+            region.imageSubresource.mipLevel = 0;
+            cmd.copyBufferToImage(src_buffer, image, vk::ImageLayout::eTransferDstOptimal, region);
+        }
+
+        void record_image_copy(vk::CommandBuffer cmd,
+                               vk::Buffer src_buffer,
+                               sizet src_offset,
+                               vk::Image image,
+                               vk::Offset3D region_offset,
+                               vk::Extent3D region_extent,
+                               vk::ImageLayout old_layout)
+        {
+            // Undefined discards the old contents, which is only valid when the whole image is written
+            const bool was_sampled = old_layout == vk::ImageLayout::eShaderReadOnlyOptimal;
+            transition_image(cmd,
+                             image,
+                             old_layout,
+                             vk::ImageLayout::eTransferDstOptimal,
+                             was_sampled ? vk::AccessFlagBits::eShaderRead : vk::AccessFlags{},
+                             vk::AccessFlagBits::eTransferWrite,
+                             was_sampled ? ShaderReadStages : vk::PipelineStageFlagBits::eTopOfPipe,
+                             vk::PipelineStageFlagBits::eTransfer);
+
+            record_buffer_to_image_copy(cmd, src_buffer, src_offset, image, region_offset, region_extent);
+
+            transition_image(cmd,
+                             image,
+                             vk::ImageLayout::eTransferDstOptimal,
+                             vk::ImageLayout::eShaderReadOnlyOptimal,
+                             vk::AccessFlagBits::eTransferWrite,
+                             vk::AccessFlagBits::eShaderRead,
+                             vk::PipelineStageFlagBits::eTransfer,
+                             ShaderReadStages);
+        }
+
         void transition_image_to_color_attachment(vk::CommandBuffer cmd, vk::Image image)
         {
             transition_image(cmd,
@@ -332,7 +785,55 @@ namespace app::gfx
 
             // #TODO: Pick best physical device
 
-            m_pimpl->physicalDevice = physicalDevices[0];
+            // Batch2D indexes its texture array per sprite, which needs non-uniform indexing
+            const auto supports_required_features = [](vk::PhysicalDevice physical_device)
+            {
+                const auto features = physical_device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>();
+                return features.get<vk::PhysicalDeviceVulkan12Features>().shaderSampledImageArrayNonUniformIndexing == VK_TRUE;
+            };
+
+            const auto it = std::find_if(physicalDevices.begin(), physicalDevices.end(), supports_required_features);
+            if (it == physicalDevices.end())
+            {
+                LOG_CRITICAL("Device - No GPU supports non-uniform indexing of sampled image arrays, which Batch2D requires!");
+            }
+            ASSERT(it != physicalDevices.end());
+
+            m_pimpl->physicalDevice = *it;
+        }
+
+        // Pick queue families
+        {
+            const auto families = m_pimpl->physicalDevice.getQueueFamilyProperties();
+            for (u32 i = 0; i < families.size(); ++i)
+            {
+                if (families[i].queueFlags & vk::QueueFlagBits::eGraphics)
+                {
+                    m_pimpl->graphicsQueueFamily = i;
+                    break;
+                }
+            }
+
+            // A family without graphics is usually a copy engine that runs alongside rendering, best of all without compute too
+            bool found_transfer_only = false;
+            m_pimpl->transferQueueFamily = m_pimpl->graphicsQueueFamily;
+            for (u32 i = 0; i < families.size() && !found_transfer_only; ++i)
+            {
+                const auto flags = families[i].queueFlags;
+                if (!(flags & vk::QueueFlagBits::eTransfer) || (flags & vk::QueueFlagBits::eGraphics))
+                {
+                    continue;
+                }
+
+                m_pimpl->transferQueueFamily = i;
+                found_transfer_only = !(flags & vk::QueueFlagBits::eCompute);
+            }
+            m_pimpl->hasTransferQueue = m_pimpl->transferQueueFamily != m_pimpl->graphicsQueueFamily;
+
+            if (m_pimpl->hasTransferQueue)
+            {
+                LOG_INFO("Device - Upload batches use transfer queue family {}", m_pimpl->transferQueueFamily);
+            }
         }
 
         // Create device
@@ -340,15 +841,27 @@ namespace app::gfx
             std::vector<const char*> extensions{ VK_KHR_SWAPCHAIN_EXTENSION_NAME };
 
             static f32 queue_priority = 1.0f;
-            std::vector<vk::DeviceQueueCreateInfo> queue_infos(1);
+            std::vector<vk::DeviceQueueCreateInfo> queue_infos(m_pimpl->hasTransferQueue ? 2 : 1);
             queue_infos[0].setQueuePriorities(queue_priority);
             queue_infos[0].setQueueCount(1);
             queue_infos[0].setQueueFamilyIndex(m_pimpl->graphicsQueueFamily);
+            if (m_pimpl->hasTransferQueue)
+            {
+                queue_infos[1].setQueuePriorities(queue_priority);
+                queue_infos[1].setQueueCount(1);
+                queue_infos[1].setQueueFamilyIndex(m_pimpl->transferQueueFamily);
+            }
 
             vk::PhysicalDeviceFeatures enabled_features{};
 
+            // Supported by the physical device picked above
+            vk::PhysicalDeviceVulkan12Features features_12{};
+            features_12.setShaderSampledImageArrayNonUniformIndexing(true);
+            features_12.setTimelineSemaphore(true);
+
             vk::PhysicalDeviceDynamicRenderingFeatures dynamic_rendering_features{};
             dynamic_rendering_features.setDynamicRendering(true);
+            dynamic_rendering_features.setPNext(&features_12);
 
             vk::DeviceCreateInfo create_info{};
             create_info.setPEnabledExtensionNames(extensions);
@@ -359,6 +872,7 @@ namespace app::gfx
             m_pimpl->device = m_pimpl->physicalDevice.createDevice(create_info);
 
             m_pimpl->graphicsQueue = m_pimpl->device.getQueue(m_pimpl->graphicsQueueFamily, 0);
+            m_pimpl->transferQueue = m_pimpl->device.getQueue(m_pimpl->transferQueueFamily, 0);
         }
 
         // Create allocator
@@ -378,7 +892,9 @@ namespace app::gfx
                 { vk::DescriptorType::eCombinedImageSampler, 1000 },
             };
 
+            // Textures free their own sets, so the pool must allow it
             vk::DescriptorPoolCreateInfo pool_info{};
+            pool_info.setFlags(vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet);
             pool_info.setMaxSets(1000);
             pool_info.setPoolSizes(pool_sizes);
             m_pimpl->descriptorPool = m_pimpl->device.createDescriptorPool(pool_info);
@@ -388,11 +904,14 @@ namespace app::gfx
                 binding.setBinding(0);
                 binding.setDescriptorCount(1);
                 binding.setDescriptorType(vk::DescriptorType::eCombinedImageSampler);
-                binding.setStageFlags(vk::ShaderStageFlagBits::eFragment);
+                binding.setStageFlags(vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment);
 
                 vk::DescriptorSetLayoutCreateInfo layout_info{};
                 layout_info.setBindings(binding);
                 m_pimpl->textureSetLayout = m_pimpl->device.createDescriptorSetLayout(layout_info);
+
+                binding.setDescriptorCount(TextureArraySize);
+                m_pimpl->textureArraySetLayout = m_pimpl->device.createDescriptorSetLayout(layout_info);
             }
         }
 
@@ -417,6 +936,9 @@ namespace app::gfx
             pool_info.setFlags(vk::CommandPoolCreateFlagBits::eResetCommandBuffer);
             pool_info.setQueueFamilyIndex(m_pimpl->graphicsQueueFamily);
             m_pimpl->cmdPool = m_pimpl->device.createCommandPool(pool_info);
+
+            pool_info.setQueueFamilyIndex(m_pimpl->transferQueueFamily);
+            m_pimpl->transferCmdPool = m_pimpl->device.createCommandPool(pool_info);
         }
 
         // Setup frames
@@ -428,11 +950,38 @@ namespace app::gfx
                 alloc_info.setCommandPool(m_pimpl->cmdPool);
                 alloc_info.setLevel(vk::CommandBufferLevel::ePrimary);
                 frame.cmd = m_pimpl->device.allocateCommandBuffers(alloc_info)[0];
+                frame.uploadCmd = m_pimpl->device.allocateCommandBuffers(alloc_info)[0];
 
                 frame.imageReadySemaphore = m_pimpl->device.createSemaphore({});
                 frame.renderDoneSemaphore = m_pimpl->device.createSemaphore({});
                 frame.cmdFence = m_pimpl->device.createFence({ vk::FenceCreateFlagBits::eSignaled });
+
+                frame.descriptorPools.push_back(create_frame_descriptor_pool(m_pimpl->device));
             }
+
+            m_pimpl->stagingRing = create_mapped_staging_buffer(m_pimpl->allocator, StagingRegionSize * FramesInFlight);
+        }
+
+        // Create pipeline cache
+        {
+            const auto initial_data = load_pipeline_cache_data(m_pimpl->physicalDevice);
+
+            vk::PipelineCacheCreateInfo cache_info{};
+            cache_info.setInitialDataSize(initial_data.size());
+            cache_info.setPInitialData(initial_data.data());
+            m_pimpl->pipelineCache = m_pimpl->device.createPipelineCache(cache_info);
+        }
+
+        // Create upload and frame timelines
+        {
+            vk::SemaphoreTypeCreateInfo type_info{};
+            type_info.setSemaphoreType(vk::SemaphoreType::eTimeline);
+            type_info.setInitialValue(0);
+
+            vk::SemaphoreCreateInfo semaphore_info{};
+            semaphore_info.setPNext(&type_info);
+            m_pimpl->uploadTimeline = m_pimpl->device.createSemaphore(semaphore_info);
+            m_pimpl->frameTimeline = m_pimpl->device.createSemaphore(semaphore_info);
         }
 
         // Create surface
@@ -459,6 +1008,12 @@ namespace app::gfx
         }
 
         m_pimpl->device.waitIdle();
+        // No frame will acquire them now
+        m_pimpl->pendingAcquires.clear();
+        run_pending_destroys(*m_pimpl, u64_max, u64_max);
+
+        save_pipeline_cache(*m_pimpl);
+        m_pimpl->device.destroy(m_pimpl->pipelineCache);
 
         clean_swapchain(*m_pimpl);
 
@@ -467,13 +1022,38 @@ namespace app::gfx
             m_pimpl->device.destroy(frame.imageReadySemaphore);
             m_pimpl->device.destroy(frame.renderDoneSemaphore);
             m_pimpl->device.destroy(frame.cmdFence);
+            for (const auto pool : frame.descriptorPools)
+            {
+                m_pimpl->device.destroy(pool);
+            }
+            frame.descriptorPools.clear();
+            release_overflow_staging(*m_pimpl, frame);
+        }
+
+        vmaDestroyBuffer(m_pimpl->allocator, m_pimpl->stagingRing.buffer, m_pimpl->stagingRing.allocation);
+        m_pimpl->stagingRing = {};
+
+        for (const auto& chunk : m_pimpl->stagingArena)
+        {
+            vmaDestroyBuffer(m_pimpl->allocator, chunk.Staging.buffer, chunk.Staging.allocation);
         }
+        m_pimpl->stagingArena.clear();
+        m_pimpl->uploadBatches.clear();
+        m_pimpl->uploadValue = 0;
+        m_pimpl->device.destroy(m_pimpl->uploadTimeline);
+
+        m_pimpl->batchReleases = {};
+        m_pimpl->lastSubmittedFrameNumber = 0;
+        m_pimpl->device.destroy(m_pimpl->frameTimeline);
 
         m_pimpl->device.destroy(m_pimpl->cmdPool);
+        m_pimpl->device.destroy(m_pimpl->transferCmdPool);
 
         m_pimpl->device.destroy(m_pimpl->nearestSampler);
         m_pimpl->device.destroy(m_pimpl->linearSampler);
 
+        m_pimpl->device.destroy(m_pimpl->textureSetLayout);
+        m_pimpl->device.destroy(m_pimpl->textureArraySetLayout);
         m_pimpl->device.destroy(m_pimpl->descriptorPool);
 
         vmaDestroyAllocator(m_pimpl->allocator);
@@ -517,6 +1097,11 @@ namespace app::gfx
         return m_pimpl->allocator;
     }
 
+    auto Device::get_pipeline_cache() const -> vk::PipelineCache
+    {
+        return m_pimpl->pipelineCache;
+    }
+
     auto Device::get_descriptor_pool() -> vk::DescriptorPool
     {
         return m_pimpl->descriptorPool;
@@ -527,6 +1112,11 @@ namespace app::gfx
         return m_pimpl->textureSetLayout;
     }
 
+    auto Device::get_texture_array_set_layout() -> vk::DescriptorSetLayout
+    {
+        return m_pimpl->textureArraySetLayout;
+    }
+
     auto Device::get_nearest_sampler() -> vk::Sampler
     {
         return m_pimpl->nearestSampler;
@@ -547,6 +1137,16 @@ namespace app::gfx
         return static_cast<u32>(m_pimpl->backBuffers.size());
     }
 
+    auto Device::get_frame_index() const -> u32
+    {
+        return m_pimpl->frameIndex;
+    }
+
+    auto Device::get_frame_number() const -> u64
+    {
+        return m_pimpl->frameNumber;
+    }
+
     auto Device::get_current_cmd() const -> vk::CommandBuffer
     {
         return m_pimpl->frames[m_pimpl->frameIndex].cmd;
@@ -556,6 +1156,49 @@ namespace app::gfx
     {
         ASSERT(m_pimpl->device);
         m_pimpl->device.waitIdle();
+        run_pending_destroys(*m_pimpl, u64_max, u64_max);
+    }
+
+    void Device::defer_destroy(std::function<void()> destroy)
+    {
+        if (!m_pimpl->device)
+        {
+            destroy();
+            return;
+        }
+
+        // Outside a frame, staged uploads and draws go out with the next frame
+        const u64 last_frame = m_pimpl->isRecordingFrame ? m_pimpl->frameNumber : m_pimpl->frameNumber + 1;
+        const u64 last_upload = m_pimpl->isRecordingBatch ? m_pimpl->uploadValue + 1 : m_pimpl->uploadValue;
+        m_pimpl->pendingDestroys.push_back({ last_frame, last_upload, std::move(destroy) });
+    }
+
+    auto Device::allocate_frame_set(vk::DescriptorSetLayout layout) -> vk::DescriptorSet
+    {
+        auto& frame = m_pimpl->get_frame();
+
+        vk::DescriptorSetAllocateInfo alloc_info{};
+        alloc_info.setSetLayouts(layout);
+
+        while (true)
+        {
+            alloc_info.setDescriptorPool(frame.descriptorPools[frame.descriptorPoolIndex]);
+
+            vk::DescriptorSet descriptor_set{};
+            const auto result = m_pimpl->device.allocateDescriptorSets(&alloc_info, &descriptor_set);
+            if (result == vk::Result::eSuccess)
+            {
+                return descriptor_set;
+            }
+            ASSERT(result == vk::Result::eErrorOutOfPoolMemory || result == vk::Result::eErrorFragmentedPool);
+
+            // The pool is full, so the frame moves on to the next one, created the first time a frame needs it
+            ++frame.descriptorPoolIndex;
+            if (frame.descriptorPoolIndex == frame.descriptorPools.size())
+            {
+                frame.descriptorPools.push_back(create_frame_descriptor_pool(m_pimpl->device));
+            }
+        }
     }
 
     auto Device::begin_single_use_cmd() -> vk::CommandBuffer
@@ -588,55 +1231,193 @@ namespace app::gfx
         m_pimpl->device.freeCommandBuffers(m_pimpl->cmdPool, cmd);
     }
 
-    void Device::upload_to_image(vk::Image image, vk::Extent3D image_extent, sizet size, const void* data)
+    void Device::begin_upload_batch()
     {
-        auto [staging_buffer, staging_buffer_alloc] = create_staging_buffer(m_pimpl->allocator, size, data);
+        ASSERT(!m_pimpl->isRecordingBatch);
 
-        auto cmd = begin_single_use_cmd();
+        // Reuse the command buffer of a finished batch, or add one when every batch is still in flight
+        const u64 completed_value = m_pimpl->device.getSemaphoreCounterValue(m_pimpl->uploadTimeline);
+        auto batch_index = static_cast<u32>(m_pimpl->uploadBatches.size());
+        for (u32 i = 0; i < m_pimpl->uploadBatches.size(); ++i)
+        {
+            if (m_pimpl->uploadBatches[i].Value <= completed_value)
+            {
+                batch_index = i;
+                break;
+            }
+        }
 
+        if (batch_index == m_pimpl->uploadBatches.size())
         {
-            vk::ImageMemoryBarrier barrier{};
-            barrier.srcAccessMask = {};
-            barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
-            barrier.oldLayout = vk::ImageLayout::eUndefined;
-            barrier.newLayout = vk::ImageLayout::eTransferDstOptimal;
-            barrier.image = image;
-            barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
-            barrier.subresourceRange.baseArrayLayer = 0;
-            barrier.subresourceRange.layerCount = 1;
-            barrier.subresourceRange.baseMipLevel = 0;
-            barrier.subresourceRange.levelCount = 1;
+            vk::CommandBufferAllocateInfo alloc_info{};
+            alloc_info.setCommandBufferCount(1);
+            alloc_info.setCommandPool(m_pimpl->transferCmdPool);
+            alloc_info.setLevel(vk::CommandBufferLevel::ePrimary);
+            m_pimpl->uploadBatches.push_back({ m_pimpl->device.allocateCommandBuffers(alloc_info)[0], 0 });
+        }
 
-            cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barrier);
+        auto& batch = m_pimpl->uploadBatches[batch_index];
+        batch.Value = m_pimpl->uploadValue + 1;
+        // On the transfer queue, earlier frames are waited for by the batch's submission instead
+        begin_upload_cmd(batch.Cmd,
+                         m_pimpl->hasTransferQueue ? vk::PipelineStageFlagBits::eTransfer
+                                                   : BufferReadStages | vk::PipelineStageFlagBits::eTransfer);
+
+        m_pimpl->batchIndex = batch_index;
+        m_pimpl->isRecordingBatch = true;
+    }
+
+    auto Device::end_upload_batch() -> UploadToken
+    {
+        ASSERT(m_pimpl->isRecordingBatch);
+
+        const auto& batch = m_pimpl->uploadBatches[m_pimpl->batchIndex];
+        m_pimpl->isRecordingBatch = false;
+        m_pimpl->uploadValue = batch.Value;
+
+        // Staging memory may not be host coherent
+        for (const auto& chunk : m_pimpl->stagingArena)
+        {
+            if (chunk.LastUse == batch.Value)
+            {
+                vmaFlushAllocation(m_pimpl->allocator, chunk.Staging.allocation, 0, chunk.Used);
+            }
         }
 
-        vk::BufferImageCopy region{};
-        region.imageExtent = image_extent;
-        region.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-        region.imageSubresource.baseArrayLayer = 0;
-        region.imageSubresource.layerCount = 1;
-        region.imageSubresource.mipLevel = 0;
-        cmd.copyBufferToImage(staging_buffer, image, vk::ImageLayout::eTransferDstOptimal, region);
+        if (!m_pimpl->hasTransferQueue)
+        {
+            end_upload_cmd(batch.Cmd);
+
+            vk::TimelineSemaphoreSubmitInfo timeline_info{};
+            timeline_info.setSignalSemaphoreValues(batch.Value);
+
+            vk::SubmitInfo submit_info{};
+            submit_info.setCommandBuffers(batch.Cmd);
+            submit_info.setSignalSemaphores(m_pimpl->uploadTimeline);
+            submit_info.setPNext(&timeline_info);
+            m_pimpl->graphicsQueue.submit(submit_info);
 
+            return { batch.Value };
+        }
+
+        // Hand everything the batch wrote over to the graphics queue, which acquires it once the batch has completed
+        auto& releases = m_pimpl->batchReleases;
+        if (!releases.Buffers.empty() || !releases.Images.empty())
         {
-            vk::ImageMemoryBarrier barrier{};
-            barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
-            barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
-            barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
-            barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-            barrier.image = image;
-            barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
-            barrier.subresourceRange.baseArrayLayer = 0;
-            barrier.subresourceRange.layerCount = 1;
-            barrier.subresourceRange.baseMipLevel = 0;
-            barrier.subresourceRange.levelCount = 1;
+            batch.Cmd.pipelineBarrier(
+                vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, {}, {}, releases.Buffers, releases.Images);
 
-            cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {}, {}, {}, barrier);
+            releases.Value = batch.Value;
+            m_pimpl->pendingAcquires.push_back(std::move(releases));
+            releases = {};
         }
+        batch.Cmd.end();
+
+        // Frames already submitted may still be reading what the batch overwrites
+        const vk::PipelineStageFlags wait_stage = vk::PipelineStageFlagBits::eTransfer;
+        vk::TimelineSemaphoreSubmitInfo timeline_info{};
+        timeline_info.setWaitSemaphoreValues(m_pimpl->lastSubmittedFrameNumber);
+        timeline_info.setSignalSemaphoreValues(batch.Value);
+
+        vk::SubmitInfo submit_info{};
+        submit_info.setWaitSemaphores(m_pimpl->frameTimeline);
+        submit_info.setWaitDstStageMask(wait_stage);
+        submit_info.setCommandBuffers(batch.Cmd);
+        submit_info.setSignalSemaphores(m_pimpl->uploadTimeline);
+        submit_info.setPNext(&timeline_info);
+        m_pimpl->transferQueue.submit(submit_info);
+
+        return { batch.Value };
+    }
 
-        end_single_use_cmd(cmd);
+    bool Device::is_upload_ready(UploadToken token) const
+    {
+        // The graphics queue runs a batch submitted to it before any frame submitted later
+        return m_pimpl->hasTransferQueue ? is_upload_complete(token) : token.Value <= m_pimpl->uploadValue;
+    }
+
+    bool Device::is_upload_complete(UploadToken token) const
+    {
+        return m_pimpl->device.getSemaphoreCounterValue(m_pimpl->uploadTimeline) >= token.Value;
+    }
 
-        vmaDestroyBuffer(m_pimpl->allocator, staging_buffer, staging_buffer_alloc);
+    void Device::wait_for_upload(UploadToken token) const
+    {
+        vk::SemaphoreWaitInfo wait_info{};
+        wait_info.setSemaphores(m_pimpl->uploadTimeline);
+        wait_info.setValues(token.Value);
+        UNUSED(m_pimpl->device.waitSemaphores(wait_info, u64_max));
+    }
+
+    void Device::upload_to_image(vk::Image image, vk::Extent3D image_extent, sizet size, const void* data)
+    {
+        const auto staging = allocate_staging(*m_pimpl, size);
+        std::memcpy(staging.Mapped, data, size);
+
+        if (!staging.IsOnTransferQueue)
+        {
+            record_image_copy(staging.Cmd, staging.Buffer, staging.Offset, image, {}, image_extent, vk::ImageLayout::eUndefined);
+            return;
+        }
+
+        // The transfer queue has no shader stages, so the release barrier makes the image ready for sampling instead
+        transition_image(staging.Cmd,
+                         image,
+                         vk::ImageLayout::eUndefined,
+                         vk::ImageLayout::eTransferDstOptimal,
+                         {},
+                         vk::AccessFlagBits::eTransferWrite,
+                         vk::PipelineStageFlagBits::eTopOfPipe,
+                         vk::PipelineStageFlagBits::eTransfer);
+        record_buffer_to_image_copy(staging.Cmd, staging.Buffer, staging.Offset, image, {}, image_extent);
+
+        auto& release = m_pimpl->batchReleases.Images.emplace_back();
+        release.setImage(image);
+        release.setOldLayout(vk::ImageLayout::eTransferDstOptimal);
+        release.setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal);
+        release.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite);
+        release.setSrcQueueFamilyIndex(m_pimpl->transferQueueFamily);
+        release.setDstQueueFamilyIndex(m_pimpl->graphicsQueueFamily);
+        release.setSubresourceRange(ColorSubresourceRange);
+    }
+
+    auto Device::stage_buffer_upload(vk::Buffer buffer, sizet offset, sizet size) -> void*
+    {
+        const auto staging = allocate_staging(*m_pimpl, size);
+
+        vk::BufferCopy region{};
+        region.setSrcOffset(staging.Offset);
+        region.setDstOffset(offset);
+        region.setSize(size);
+        staging.Cmd.copyBuffer(staging.Buffer, buffer, region);
+
+        if (staging.IsOnTransferQueue)
+        {
+            auto& release = m_pimpl->batchReleases.Buffers.emplace_back();
+            release.setBuffer(buffer);
+            release.setOffset(offset);
+            release.setSize(size);
+            release.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite);
+            release.setSrcQueueFamilyIndex(m_pimpl->transferQueueFamily);
+            release.setDstQueueFamilyIndex(m_pimpl->graphicsQueueFamily);
+        }
+
+        return staging.Mapped;
+    }
+
+    void Device::upload_to_buffer(vk::Buffer buffer, sizet offset, sizet size, const void* data)
+    {
+        std::memcpy(stage_buffer_upload(buffer, offset, size), data, size);
+    }
+
+    void Device::update_image_region(vk::Image image, vk::Offset3D region_offset, vk::Extent3D region_extent, sizet size, const void* data)
+    {
+        // The graphics queue owns sampled images, and moving one to the transfer queue and back costs more than it would save
+        const auto staging = m_pimpl->hasTransferQueue ? allocate_frame_staging(*m_pimpl, size) : allocate_staging(*m_pimpl, size);
+        std::memcpy(staging.Mapped, data, size);
+
+        record_image_copy(
+            staging.Cmd, staging.Buffer, staging.Offset, image, region_offset, region_extent, vk::ImageLayout::eShaderReadOnlyOptimal);
     }
 
     void Device::new_frame()
@@ -649,6 +1430,9 @@ namespace app::gfx
 
         auto& frame = m_pimpl->get_frame();
 
+        // Waited on before acquiring, so a frame skipped for an out of date swapchain also leaves the slot free to reuse
+        UNUSED(m_pimpl->device.waitForFences(frame.cmdFence, true, u64_max));
+
         auto result = m_pimpl->device.acquireNextImageKHR(m_pimpl->swapchain, u64_max, frame.imageReadySemaphore);
         if (result.result == vk::Result::eErrorOutOfDateKHR || result.result == vk::Result::eSuboptimalKHR)
         {
@@ -657,8 +1441,25 @@ namespace app::gfx
         }
         m_pimpl->imageIndex = result.value;
 
-        UNUSED(m_pimpl->device.waitForFences(frame.cmdFence, true, u64_max));
+        // Only advanced once the slot's previous frame has finished, as per-frame data is reused when the number changes
+        ++m_pimpl->frameNumber;
+
         m_pimpl->device.resetFences(frame.cmdFence);
+        m_pimpl->isRecordingFrame = true;
+
+        // Frames finish in submission order, so everything up to this slot's last frame is done
+        const u64 completed_upload_value = m_pimpl->device.getSemaphoreCounterValue(m_pimpl->uploadTimeline);
+        run_pending_destroys(*m_pimpl, frame.submittedFrameNumber, completed_upload_value);
+
+        for (const auto pool : frame.descriptorPools)
+        {
+            m_pimpl->device.resetDescriptorPool(pool);
+        }
+        frame.descriptorPoolIndex = 0;
+        if (!frame.isRecordingUploads)
+        {
+            release_overflow_staging(*m_pimpl, frame);
+        }
 
         frame.cmd.reset();
 
@@ -677,13 +1478,43 @@ namespace app::gfx
 
         frame.cmd.end();
 
-        vk::PipelineStageFlags wait_stage = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+        acquire_completed_uploads(*m_pimpl, frame);
+
+        // The frame's uploads run first in the same submission, so its fence also covers their staging memory
+        std::array<vk::CommandBuffer, 2> cmds{ frame.uploadCmd, frame.cmd };
+        const bool has_uploads = frame.isRecordingUploads;
+        const u64 acquired_upload_value = has_uploads ? frame.acquiredUploadValue : 0;
+        if (has_uploads)
+        {
+            end_frame_uploads(*m_pimpl, frame);
+        }
+
+        // The upload timeline wait only orders the acquires after their releases, the batches have already completed
+        const std::array<vk::Semaphore, 2> wait_semaphores{ frame.imageReadySemaphore, m_pimpl->uploadTimeline };
+        const std::array<vk::PipelineStageFlags, 2> wait_stages{ vk::PipelineStageFlagBits::eColorAttachmentOutput, AcquireStages };
+        const std::array<u64, 2> wait_values{ 0, acquired_upload_value };
+        const u32 wait_count = acquired_upload_value > 0 ? 2 : 1;
+
+        const std::array<vk::Semaphore, 2> signal_semaphores{ frame.renderDoneSemaphore, m_pimpl->frameTimeline };
+        const std::array<u64, 2> signal_values{ 0, m_pimpl->frameNumber };
+
+        vk::TimelineSemaphoreSubmitInfo timeline_info{};
+        timeline_info.setWaitSemaphoreValueCount(wait_count);
+        timeline_info.setPWaitSemaphoreValues(wait_values.data());
+        timeline_info.setSignalSemaphoreValues(signal_values);
+
         vk::SubmitInfo submit_info{};
-        submit_info.setWaitSemaphores(frame.imageReadySemaphore);
-        submit_info.setWaitDstStageMask(wait_stage);
-        submit_info.setCommandBuffers(frame.cmd);
-        submit_info.setSignalSemaphores(frame.renderDoneSemaphore);
+        submit_info.setWaitSemaphoreCount(wait_count);
+        submit_info.setPWaitSemaphores(wait_semaphores.data());
+        submit_info.setPWaitDstStageMask(wait_stages.data());
+        submit_info.setCommandBufferCount(has_uploads ? 2 : 1);
+        submit_info.setPCommandBuffers(has_uploads ? cmds.data() : cmds.data() + 1);
+        submit_info.setSignalSemaphores(signal_semaphores);
+        submit_info.setPNext(&timeline_info);
         m_pimpl->graphicsQueue.submit(submit_info, frame.cmdFence);
+        frame.submittedFrameNumber = m_pimpl->frameNumber;
+        m_pimpl->lastSubmittedFrameNumber = m_pimpl->frameNumber;
+        m_pimpl->isRecordingFrame = false;
 
         vk::PresentInfoKHR present_info{};
         present_info.setWaitSemaphores(frame.renderDoneSemaphore);
@@ -2,15 +2,22 @@
 
 #include "core/core.hpp"
 
+#include "upload_token.hpp"
+
 #include <vulkan/vulkan.hpp>
 #include <vk_mem_alloc.h>
 
+#include <functional>
+
 struct GLFWwindow;
 
 namespace app::gfx
 {
     class Buffer;
 
+    /* Frames the CPU may record ahead of the GPU. Per-frame resources are only reused once their frame's fence has signalled. */
+    constexpr u32 FramesInFlight = 2;
+
     class Device
     {
     public:
@@ -39,9 +46,14 @@ namespace app::gfx
 
         auto get_allocator() const -> VmaAllocator;
 
+        /* Shared by every pipeline, loaded at init() and saved at shutdown() so later launches skip compiling them again. */
+        auto get_pipeline_cache() const -> vk::PipelineCache;
+
         auto get_descriptor_pool() -> vk::DescriptorPool;
 
         auto get_texture_set_layout() -> vk::DescriptorSetLayout;
+        /* Layout of TextureArraySize combined image samplers at binding 0. */
+        auto get_texture_array_set_layout() -> vk::DescriptorSetLayout;
 
         auto get_nearest_sampler() -> vk::Sampler;
         auto get_linear_sampler() -> vk::Sampler;
@@ -49,16 +61,55 @@ namespace app::gfx
         auto get_swapchain_format() -> vk::Format;
         auto get_swapchain_image_count() -> u32;
 
+        /* Slot of the frame being recorded, in [0, FramesInFlight). */
+        auto get_frame_index() const -> u32;
+        /* Incremented by each new_frame() that begins a frame, once the GPU has finished with the frame slot. */
+        auto get_frame_number() const -> u64;
+
         auto get_current_cmd() const -> vk::CommandBuffer;
 
         /* Commands */
 
+        /* Also runs every deferred destroy. */
         void wait_idle();
 
+        /**
+         * Runs destroy once the GPU has finished every frame recorded so far, including uploads staged for the next one.
+         * Resources can then be released or replaced while frames in flight still use them.
+         */
+        void defer_destroy(std::function<void()> destroy);
+
+        /* Allocates a set from the current frame's pool, which is reset once the frame's commands have finished. */
+        auto allocate_frame_set(vk::DescriptorSetLayout layout) -> vk::DescriptorSet;
+
         auto begin_single_use_cmd() -> vk::CommandBuffer;
         void end_single_use_cmd(vk::CommandBuffer cmd);
 
+        /**
+         * Uploads between begin_upload_batch() and end_upload_batch() are recorded into one command buffer, staged through a
+         * reusable arena, and submitted together without waiting. Batches cannot nest.
+         * Batches run on a dedicated transfer queue when the device has one, alongside rendering, and hand what they wrote over
+         * to the graphics queue once they complete. Image region updates always go through the frame instead.
+         */
+        void begin_upload_batch();
+        auto end_upload_batch() -> UploadToken;
+        bool is_upload_complete(UploadToken token) const;
+        /* Whether commands recorded from now on may use what the batch uploaded. */
+        bool is_upload_ready(UploadToken token) const;
+        void wait_for_upload(UploadToken token) const;
+
+        /* Both leave the image ready for sampling once the copy has run, with the open upload batch or else the next frame. */
         void upload_to_image(vk::Image image, vk::Extent3D image_extent, sizet size, const void* data);
+        void update_image_region(vk::Image image, vk::Offset3D region_offset, vk::Extent3D region_extent, sizet size, const void* data);
+
+        /**
+         * Records a copy from staging memory and returns the memory to fill. Outside an upload batch, the copies come from the
+         * current frame's region of the staging ring and run ahead of the frame's commands in its submission, so the memory may
+         * be filled from any thread until flush_frame(). Uploads recorded before new_frame() go out with the next frame.
+         * Inside a batch, the memory must be filled before end_upload_batch().
+         */
+        auto stage_buffer_upload(vk::Buffer buffer, sizet offset, sizet size) -> void*;
+        void upload_to_buffer(vk::Buffer buffer, sizet offset, sizet size, const void* data);
 
         void new_frame();
         void flush_frame();
@@ -3,8 +3,11 @@
 #include "device.hpp"
 #include "shader.hpp"
 #include "buffer.hpp"
+#include "buffer_pool.hpp"
 #include "texture.hpp"
 
+#include "core/file_watcher.hpp"
+
 #include <GLFW/glfw3.h>
 #define GLFW_EXPOSE_NATIVE_WIN32
 #include <GLFW/glfw3native.h>
@@ -17,12 +20,18 @@
 #include <glm/ext/matrix_transform.hpp>
 #include <glm/ext/matrix_clip_space.hpp>
 
+#include <array>
+#include <memory>
+
 #define APP_ENABLE_IMGUI
 
 namespace app::gfx
 {
     static RenderMetrics s_renderMetrics{};
 
+    // Watched for hot reload, shaders are loaded from here by path
+    constexpr const char* ShaderDirectory = "../../assets/shaders";
+
     auto Renderer::GetMetrics() -> const RenderMetrics&
     {
         return s_renderMetrics;
@@ -40,6 +49,61 @@ namespace app::gfx
         Device device{};
 
         Shared<Shader> defaultShader = nullptr;
+
+        glm::vec2 viewMin{};
+        glm::vec2 viewMax{};
+        glm::mat4 viewProj{ 1.0f };
+
+        // Buffers bound in the frame's command buffer, so draws from the same pool block skip rebinding
+        vk::Buffer boundVertexBuffer{};
+        vk::Buffer boundIndexBuffer{};
+
+        core::JobSystem* jobSystem = nullptr;
+
+        // Every shader created, so reloads can be matched to changed files and swapped in between frames
+        std::vector<std::weak_ptr<Shader>> shaders{};
+        core::FileWatcher shaderWatcher{};
+
+        void update_shaders()
+        {
+            const auto changed_files = shaderWatcher.poll();
+
+            std::erase_if(shaders, [](const std::weak_ptr<Shader>& shader) { return shader.expired(); });
+            for (const auto& weak_shader : shaders)
+            {
+                const auto shader = weak_shader.lock();
+                for (const auto& file : changed_files)
+                {
+                    // Shaders whose first build failed are retried too, they still have their layout
+                    if (shader->get_layout() && shader->uses_file(file))
+                    {
+                        LOG_INFO("Renderer - Reloading shader <{}>", file.string());
+                        shader->reload_async(*jobSystem);
+                        break;
+                    }
+                }
+
+                shader->update();
+            }
+        }
+
+        void bind_vertex_buffer(vk::CommandBuffer cmd, const Buffer& buffer)
+        {
+            if (boundVertexBuffer != buffer.get_buffer())
+            {
+                boundVertexBuffer = buffer.get_buffer();
+                cmd.bindVertexBuffers(0, boundVertexBuffer, { 0 });
+            }
+        }
+
+        void bind_index_buffer(vk::CommandBuffer cmd, const Buffer& buffer)
+        {
+            if (boundIndexBuffer != buffer.get_buffer())
+            {
+                boundIndexBuffer = buffer.get_buffer();
+                cmd.bindIndexBuffer(boundIndexBuffer, 0, vk::IndexType::eUint32);
+            }
+        }
     };
 
     Renderer::Renderer() : m_pimpl(new RendererPimpl) {}
@@ -96,6 +160,7 @@ namespace app::gfx
             init_info.QueueFamily = m_pimpl->device.get_graphics_family();
             init_info.Queue = m_pimpl->device.get_graphics_queue();
             init_info.DescriptorPool = m_pimpl->device.get_descriptor_pool();
+            init_info.PipelineCache = m_pimpl->device.get_pipeline_cache();
             init_info.Subpass = 0;
             init_info.MinImageCount = 2;
             init_info.ImageCount = m_pimpl->device.get_swapchain_image_count();
@@ -136,6 +201,17 @@ namespace app::gfx
 
         m_pimpl->defaultShader = nullptr;
 
+        // Owners may keep their shaders past shutdown, so pipelines and reloads in progress are finished with here
+        m_pimpl->shaderWatcher.shutdown();
+        for (const auto& weak_shader : m_pimpl->shaders)
+        {
+            if (const auto shader = weak_shader.lock())
+            {
+                shader->destroy();
+            }
+        }
+        m_pimpl->shaders.clear();
+
 #ifdef APP_ENABLE_IMGUI
         ImPlot::DestroyContext();
         ImGui_ImplVulkan_Shutdown();
@@ -151,6 +227,35 @@ namespace app::gfx
         glfwTerminate();
     }
 
+    void Renderer::set_job_system(core::JobSystem* job_system)
+    {
+        m_pimpl->jobSystem = job_system;
+        if (job_system == nullptr)
+        {
+            m_pimpl->shaderWatcher.shutdown();
+        }
+    }
+
+    void Renderer::set_shader_hot_reload(bool is_enabled)
+    {
+        if (!is_enabled)
+        {
+            m_pimpl->shaderWatcher.shutdown();
+            return;
+        }
+
+        if (m_pimpl->jobSystem == nullptr)
+        {
+            LOG_WARN("Renderer - Shader hot reload needs a job system!");
+            return;
+        }
+
+        if (!m_pimpl->shaderWatcher.is_watching())
+        {
+            m_pimpl->shaderWatcher.init(ShaderDirectory, ".spv");
+        }
+    }
+
     auto Renderer::get_window_handle() const -> GLFWwindow*
     {
         return m_pimpl->windowHandle;
@@ -161,9 +266,61 @@ namespace app::gfx
         return glfwWindowShouldClose(m_pimpl->windowHandle);
     }
 
+    bool Renderer::is_shader_hot_reload_enabled() const
+    {
+        return m_pimpl->shaderWatcher.is_watching();
+    }
+
+    auto Renderer::get_frame_index() const -> u32
+    {
+        return m_pimpl->device.get_frame_index();
+    }
+
+    auto Renderer::get_frame_number() const -> u64
+    {
+        return m_pimpl->device.get_frame_number();
+    }
+
+    auto Renderer::get_viewport_size() const -> glm::vec2
+    {
+        return { 1600.0f, 900.0f };
+    }
+
+    auto Renderer::get_view_min() const -> glm::vec2
+    {
+        return m_pimpl->viewMin;
+    }
+
+    auto Renderer::get_view_max() const -> glm::vec2
+    {
+        return m_pimpl->viewMax;
+    }
+
+    auto Renderer::get_view_projection() const -> const glm::mat4&
+    {
+        return m_pimpl->viewProj;
+    }
+
+    auto Renderer::screen_to_world(const glm::vec2& screen_pos) const -> glm::vec2
+    {
+        return m_pimpl->viewMin + (screen_pos / get_viewport_size()) * (m_pimpl->viewMax - m_pimpl->viewMin);
+    }
+
+    bool Renderer::is_upload_complete(UploadToken token) const
+    {
+        return m_pimpl->device.is_upload_complete(token);
+    }
+
+    bool Renderer::is_upload_ready(UploadToken token) const
+    {
+        return m_pimpl->device.is_upload_ready(token);
+    }
+
     auto Renderer::create_shader() const -> Shared<Shader>
     {
-        return CreateShared<Shader>(&m_pimpl->device);
+        auto shader = CreateShared<Shader>(&m_pimpl->device);
+        m_pimpl->shaders.push_back(shader);
+        return shader;
     }
 
     auto Renderer::create_buffer() const -> Shared<Buffer>
@@ -171,17 +328,40 @@ namespace app::gfx
         return CreateShared<Buffer>(&m_pimpl->device);
     }
 
+    auto Renderer::create_buffer_pool() const -> Shared<BufferPool>
+    {
+        return CreateShared<BufferPool>(&m_pimpl->device);
+    }
+
     auto Renderer::create_texture() const -> Shared<Texture>
     {
         return CreateShared<Texture>(&m_pimpl->device);
     }
 
+    void Renderer::begin_upload_batch()
+    {
+        m_pimpl->device.begin_upload_batch();
+    }
+
+    auto Renderer::end_upload_batch() -> UploadToken
+    {
+        return m_pimpl->device.end_upload_batch();
+    }
+
+    void Renderer::wait_for_upload(UploadToken token) const
+    {
+        m_pimpl->device.wait_for_upload(token);
+    }
+
     void Renderer::new_frame(const glm::vec3 cam_pos, f32 cam_ortho_size)
     {
         s_renderMetrics.DrawCallCount = 0;
         s_renderMetrics.TriangleCount = 0;
 
         m_pimpl->device.new_frame();
+        m_pimpl->update_shaders();
+        m_pimpl->boundVertexBuffer = nullptr;
+        m_pimpl->boundIndexBuffer = nullptr;
 
         ImGui_ImplVulkan_NewFrame();
         ImGui_ImplGlfw_NewFrame();
@@ -203,10 +383,17 @@ namespace app::gfx
         bind_shader(m_pimpl->defaultShader.get());
 
         const float aspect_ratio = 1600.0f / 900.0f;
-        glm::mat4 push_data[2];
-        push_data[0] =
+
+        const glm::vec2 view_half_extent = { cam_ortho_size * aspect_ratio, cam_ortho_size };
+        m_pimpl->viewMin = glm::vec2(cam_pos) - view_half_extent;
+        m_pimpl->viewMax = glm::vec2(cam_pos) + view_half_extent;
+
+        m_pimpl->viewProj =
             glm::orthoLH_ZO(-cam_ortho_size * aspect_ratio, cam_ortho_size * aspect_ratio, -cam_ortho_size, cam_ortho_size, 0.0f, 1.0f) *
             glm::inverse(glm::translate(glm::mat4(1.0f), cam_pos));
+
+        glm::mat4 push_data[2];
+        push_data[0] = m_pimpl->viewProj;
         push_data[1] = glm::mat4(1.0f);
 
         set_push_constants(m_pimpl->defaultShader.get(), sizeof(glm::mat4) * 2, push_data);
@@ -236,7 +423,7 @@ namespace app::gfx
         cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, shader->get_pipeline());
     }
 
-    void Renderer::bind_texture(Shader* shader, Texture* texture)
+    void Renderer::bind_texture(Shader* shader, Texture* texture, u32 set)
     {
         ASSERT(shader != nullptr && shader->is_valid());
         ASSERT(texture != nullptr && texture->is_valid());
@@ -245,7 +432,37 @@ namespace app::gfx
 
         auto layout = shader->get_layout();
         auto sets = { texture->get_set() };
-        cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, layout, 0, sets, {});
+        cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, layout, set, sets, {});
+    }
+
+    void Renderer::bind_textures(Shader* shader, const std::vector<Texture*>& textures, u32 set)
+    {
+        ASSERT(shader != nullptr && shader->is_valid());
+        ASSERT(!textures.empty() && textures.size() <= TextureArraySize);
+
+        auto& device = m_pimpl->device;
+        auto descriptor_set = device.allocate_frame_set(device.get_texture_array_set_layout());
+
+        std::array<vk::DescriptorImageInfo, TextureArraySize> image_infos{};
+        for (u32 i = 0; i < TextureArraySize; ++i)
+        {
+            const auto* texture = i < textures.size() ? textures[i] : textures[0];
+            ASSERT(texture != nullptr && texture->is_valid());
+
+            image_infos[i].setImageView(texture->get_view());
+            image_infos[i].setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal);
+            image_infos[i].setSampler(device.get_nearest_sampler());
+        }
+
+        vk::WriteDescriptorSet write{};
+        write.setDescriptorType(vk::DescriptorType::eCombinedImageSampler);
+        write.setDstBinding(0);
+        write.setDstSet(descriptor_set);
+        write.setImageInfo(image_infos);
+        device.get_device().updateDescriptorSets(write, {});
+
+        auto cmd = device.get_current_cmd();
+        cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, shader->get_layout(), set, descriptor_set, {});
     }
 
     void Renderer::set_push_constants(Shader* shader, u32 size, const void* data)
@@ -260,18 +477,46 @@ namespace app::gfx
         cmd.pushConstants(shader->get_layout(), vk::ShaderStageFlagBits::eVertex, 0, size, data);
     }
 
-    void Renderer::draw_indexed(Buffer* vertex_buffer, Buffer* index_buffer, u32 index_count)
+    void Renderer::draw(u32 vertex_count)
+    {
+        if (vertex_count == 0)
+            return;
+
+        auto cmd = m_pimpl->device.get_current_cmd();
+        cmd.draw(vertex_count, 1, 0, 0);
+
+        s_renderMetrics.DrawCallCount++;
+        s_renderMetrics.TriangleCount += vertex_count / 3;
+    }
+
+    void Renderer::draw_indexed(Buffer* vertex_buffer, Buffer* index_buffer, u32 index_count, u32 first_index, i32 vertex_offset)
     {
         if (index_count == 0)
             return;
 
         auto cmd = m_pimpl->device.get_current_cmd();
-        cmd.bindVertexBuffers(0, vertex_buffer->get_buffer(), { 0 });
-        cmd.bindIndexBuffer(index_buffer->get_buffer(), 0, vk::IndexType::eUint32);
-        cmd.drawIndexed(index_count, 1, 0, 0, 0);
+        m_pimpl->bind_vertex_buffer(cmd, *vertex_buffer);
+        m_pimpl->bind_index_buffer(cmd, *index_buffer);
+
+        const u32 pool_first_index = first_index + index_buffer->get_element_offset();
+        const i32 pool_vertex_offset = vertex_offset + static_cast<i32>(vertex_buffer->get_element_offset());
+        cmd.drawIndexed(index_count, 1, pool_first_index, pool_vertex_offset, 0);
 
         s_renderMetrics.DrawCallCount++;
         s_renderMetrics.TriangleCount += index_count / 3;
     }
 
+    void Renderer::draw_instanced(Buffer* instance_buffer, u32 vertex_count, u32 instance_count, u32 first_instance)
+    {
+        if (vertex_count == 0 || instance_count == 0)
+            return;
+
+        auto cmd = m_pimpl->device.get_current_cmd();
+        m_pimpl->bind_vertex_buffer(cmd, *instance_buffer);
+        cmd.draw(vertex_count, instance_count, 0, first_instance + instance_buffer->get_element_offset());
+
+        s_renderMetrics.DrawCallCount++;
+        s_renderMetrics.TriangleCount += (vertex_count / 3) * instance_count;
+    }
+
 }
@@ -2,8 +2,19 @@
 
 #include "core/core.hpp"
 
+#include "upload_token.hpp"
+
+#include <glm/ext/matrix_float4x4.hpp>
+
+#include <vector>
+
 struct GLFWwindow;
 
+namespace app::core
+{
+    class JobSystem;
+}
+
 namespace app::gfx
 {
     struct RenderMetrics
@@ -22,6 +33,7 @@ namespace app::gfx
 
     class Shader;
     class Buffer;
+    class BufferPool;
     class Texture;
 
     class Renderer
@@ -38,27 +50,77 @@ namespace app::gfx
         void init();
         void shutdown();
 
+        /* Setters */
+
+        /* Runs shader reloads. Required before enabling shader hot reload. */
+        void set_job_system(core::JobSystem* job_system);
+        /* Rebuilds the shaders using a .spv file in the shader directory whenever it is written, without stalling frames. */
+        void set_shader_hot_reload(bool is_enabled);
+
         /* Getters */
 
         auto get_window_handle() const -> GLFWwindow*;
 
         bool has_window_requested_close();
+        bool is_shader_hot_reload_enabled() const;
+
+        /* Slot of the frame being recorded, in [0, FramesInFlight). */
+        auto get_frame_index() const -> u32;
+        /* Incremented by each new_frame() that begins a frame, once the GPU has finished with the frame slot. */
+        auto get_frame_number() const -> u64;
+
+        /* Size in pixels of the area the world is drawn into. */
+        auto get_viewport_size() const -> glm::vec2;
+
+        /* World-space rectangle visible through the camera passed to the last new_frame(). */
+        auto get_view_min() const -> glm::vec2;
+        auto get_view_max() const -> glm::vec2;
+        auto get_view_projection() const -> const glm::mat4&;
+
+        /* Maps a window position in pixels to the world position under it. */
+        auto screen_to_world(const glm::vec2& screen_pos) const -> glm::vec2;
+
+        bool is_upload_complete(UploadToken token) const;
+        /* Whether draws recorded from now on may use what the batch uploaded, which can be sooner than its completion. */
+        bool is_upload_ready(UploadToken token) const;
 
         /* Commands */
 
         auto create_shader() const -> Shared<Shader>;
         auto create_buffer() const -> Shared<Buffer>;
+        auto create_buffer_pool() const -> Shared<BufferPool>;
         auto create_texture() const -> Shared<Texture>;
 
+        /**
+         * Records every buffer and texture upload until end_upload_batch() into one submission, so loading many assets costs
+         * a single wait on the returned token rather than one per asset.
+         */
+        void begin_upload_batch();
+        auto end_upload_batch() -> UploadToken;
+        void wait_for_upload(UploadToken token) const;
+
         void new_frame(const glm::vec3 cam_pos, f32 cam_ortho_size);
         void end_frame();
 
         void bind_shader(Shader* shader);
-        void bind_texture(Shader* shader, Texture* texture);
+        void bind_texture(Shader* shader, Texture* texture, u32 set = 0);
+        /**
+         * Binds up to TextureArraySize textures as one array set, valid until the end of the frame.
+         * Unused array slots repeat the first texture.
+         */
+        void bind_textures(Shader* shader, const std::vector<Texture*>& textures, u32 set);
 
         void set_push_constants(Shader* shader, u32 size, const void* data);
 
-        void draw_indexed(Buffer* vertex_buffer, Buffer* index_buffer, u32 index_count);
+        /* Draws without vertex buffers, for shaders that make their own vertices from gl_VertexIndex. */
+        void draw(u32 vertex_count);
+        /**
+         * vertex_offset is added to every index, so one index pattern can serve vertices anywhere in the buffer.
+         * Buffers from a BufferPool are addressed by their element offset, so consecutive draws from one block share its binding.
+         */
+        void draw_indexed(Buffer* vertex_buffer, Buffer* index_buffer, u32 index_count, u32 first_index = 0, i32 vertex_offset = 0);
+        /* Draws vertex_count vertices per instance, with instance_buffer bound to the shader's per-instance binding. */
+        void draw_instanced(Buffer* instance_buffer, u32 vertex_count, u32 instance_count, u32 first_instance = 0);
 
     private:
         struct RendererPimpl;
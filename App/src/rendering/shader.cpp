@@ -2,10 +2,15 @@
 
 #include "device.hpp"
 
+#include "core/job_system.hpp"
+
 #include <vulkan/vulkan.hpp>
 
 #include <glm/ext/matrix_float4x4.hpp>
 
+#include <atomic>
+#include <exception>
+#include <filesystem>
 #include <string>
 #include <fstream>
 
@@ -13,6 +18,8 @@ namespace app::gfx
 {
     namespace
     {
+        std::atomic<u32> s_nextShaderId = 1;
+
         auto read_spirv_file(const std::string& filename) -> std::vector<u32>
         {
             std::ifstream file(filename, std::ios::ate | std::ios::binary);
@@ -31,24 +38,232 @@ namespace app::gfx
 
             file.close();
 
+            // Catches files still being written when they are reloaded
+            constexpr u32 SpirvMagic = 0x07230203;
+            if (buffer.empty() || buffer[0] != SpirvMagic || fileSize % sizeof(u32) != 0)
+            {
+                LOG_ERROR("Shader - <{}> is not a valid SPIRV file!", filename);
+                return {};
+            }
+
             return buffer;
         }
+
+        auto get_attribute_size(vk::Format format) -> u32
+        {
+            switch (format)
+            {
+                case vk::Format::eR32Sfloat:
+                case vk::Format::eR32Uint:
+                case vk::Format::eR16G16Uint:
+                case vk::Format::eR8G8B8A8Unorm:
+                case vk::Format::eR8G8B8A8Uint: return 4;
+                case vk::Format::eR32G32Sfloat:
+                case vk::Format::eR32G32Uint:
+                case vk::Format::eR16G16B16A16Unorm: return 8;
+                case vk::Format::eR32G32B32Sfloat: return 12;
+                case vk::Format::eR32G32B32A32Sfloat: return 16;
+                default: ASSERT(false); return 0;
+            }
+        }
+
+        // Only reads its arguments, so it can run on a worker while the shader keeps drawing with its current pipeline
+        auto create_pipeline(vk::Device device,
+                             vk::PipelineCache pipeline_cache,
+                             vk::PipelineLayout layout,
+                             vk::Format color_format,
+                             const ShaderInfo& info) -> vk::Pipeline
+        {
+            // Both files are read first, so a missing one leaves no module behind
+            auto vert_spv_code = read_spirv_file(info.VertexFile);
+            auto frag_spv_code = read_spirv_file(info.FragmentFile);
+            if (vert_spv_code.empty() || frag_spv_code.empty())
+            {
+                return {};
+            }
+
+            vk::ShaderModuleCreateInfo moduleInfo{};
+            moduleInfo.setCode(vert_spv_code);
+            vk::ShaderModule vertShaderModule = device.createShaderModule(moduleInfo);
+
+            moduleInfo.setCode(frag_spv_code);
+            vk::ShaderModule fragShaderModule = device.createShaderModule(moduleInfo);
+
+            vk::PipelineShaderStageCreateInfo vertShaderStageInfo{};
+            vertShaderStageInfo.stage = vk::ShaderStageFlagBits::eVertex;
+            vertShaderStageInfo.module = vertShaderModule;
+            vertShaderStageInfo.pName = "main";
+
+            vk::PipelineShaderStageCreateInfo fragShaderStageInfo{};
+            fragShaderStageInfo.stage = vk::ShaderStageFlagBits::eFragment;
+            fragShaderStageInfo.module = fragShaderModule;
+            fragShaderStageInfo.pName = "main";
+
+            std::vector<vk::PipelineShaderStageCreateInfo> shaderStages = { vertShaderStageInfo, fragShaderStageInfo };
+
+            std::vector<vk::VertexInputAttributeDescription> attributes(info.VertexAttributes.size());
+            u32 stride = 0;
+            for (u32 i = 0; i < attributes.size(); ++i)
+            {
+                attributes[i].setBinding(0);
+                attributes[i].setLocation(i);
+                attributes[i].setFormat(info.VertexAttributes[i]);
+                attributes[i].setOffset(stride);
+                stride += get_attribute_size(info.VertexAttributes[i]);
+            }
+
+            vk::VertexInputBindingDescription binding{};
+            binding.setBinding(0);
+            binding.setInputRate(info.VertexInputRate);
+            binding.setStride(stride);
+
+            vk::PipelineVertexInputStateCreateInfo vertexInputInfo{};
+            if (!attributes.empty())
+            {
+                vertexInputInfo.setVertexBindingDescriptions(binding);
+                vertexInputInfo.setVertexAttributeDescriptions(attributes);
+            }
+
+            vk::PipelineInputAssemblyStateCreateInfo inputAssembly{};
+            inputAssembly.topology = vk::PrimitiveTopology::eTriangleList;
+            inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+            vk::Viewport viewport{};
+            vk::Rect2D scissor{};
+
+            vk::PipelineViewportStateCreateInfo viewportState{};
+            viewportState.setViewports(viewport);
+            viewportState.setScissors(scissor);
+
+            vk::PipelineRasterizationStateCreateInfo rasterizer{};
+            rasterizer.depthClampEnable = VK_FALSE;
+            rasterizer.rasterizerDiscardEnable = VK_FALSE;
+            rasterizer.polygonMode = vk::PolygonMode::eFill;
+            rasterizer.lineWidth = 1.0f;
+            rasterizer.cullMode = vk::CullModeFlagBits::eBack;
+            rasterizer.frontFace = vk::FrontFace::eClockwise;
+            rasterizer.depthBiasEnable = VK_FALSE;
+
+            vk::PipelineMultisampleStateCreateInfo multisampling{};
+            multisampling.sampleShadingEnable = VK_FALSE;
+            multisampling.rasterizationSamples = vk::SampleCountFlagBits::e1;
+
+            // Depth/Stencil State
+
+            vk::PipelineColorBlendAttachmentState colorBlendAttachment{};
+            colorBlendAttachment.setBlendEnable(true);
+            colorBlendAttachment.setSrcColorBlendFactor(vk::BlendFactor::eSrcAlpha);
+            colorBlendAttachment.setDstColorBlendFactor(vk::BlendFactor::eOneMinusSrcAlpha);
+            colorBlendAttachment.setColorBlendOp(vk::BlendOp::eAdd);
+            colorBlendAttachment.setSrcAlphaBlendFactor(vk::BlendFactor::eOne);
+            colorBlendAttachment.setDstAlphaBlendFactor(vk::BlendFactor::eOneMinusSrcAlpha);
+            colorBlendAttachment.setAlphaBlendOp(vk::BlendOp::eAdd);
+            colorBlendAttachment.setColorWriteMask(vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+                                                   vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA);
+
+            vk::PipelineColorBlendStateCreateInfo colorBlending{};
+            colorBlending.logicOpEnable = VK_FALSE;
+            colorBlending.attachmentCount = 1;
+            colorBlending.pAttachments = &colorBlendAttachment;
+
+            std::vector dynamicStates = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
+            vk::PipelineDynamicStateCreateInfo dynamicState{};
+            dynamicState.setDynamicStates(dynamicStates);
+
+            vk::PipelineRenderingCreateInfo pipelineRenderingInfo{};
+            pipelineRenderingInfo.setColorAttachmentFormats(color_format);
+
+            vk::GraphicsPipelineCreateInfo pipeline_info{};
+            pipeline_info.stageCount = static_cast<u32>(shaderStages.size());
+            pipeline_info.pStages = shaderStages.data();
+            pipeline_info.pNext = &pipelineRenderingInfo;
+            pipeline_info.pVertexInputState = &vertexInputInfo;
+            pipeline_info.pInputAssemblyState = &inputAssembly;
+            pipeline_info.pViewportState = &viewportState;
+            pipeline_info.pRasterizationState = &rasterizer;
+            pipeline_info.pMultisampleState = &multisampling;
+            pipeline_info.pDepthStencilState = nullptr;
+            pipeline_info.pColorBlendState = &colorBlending;
+            pipeline_info.pDynamicState = &dynamicState;
+            pipeline_info.layout = layout;
+            pipeline_info.subpass = 0;
+
+            // Reports failure rather than throwing, so the modules are released either way
+            vk::Pipeline pipeline{};
+            const auto result = device.createGraphicsPipelines(pipeline_cache, 1, &pipeline_info, nullptr, &pipeline);
+
+            device.destroy(vertShaderModule);
+            device.destroy(fragShaderModule);
+
+            if (result != vk::Result::eSuccess)
+            {
+                LOG_ERROR(
+                    "Shader - Failed to create pipeline for <{}>, <{}>: {}", info.VertexFile, info.FragmentFile, vk::to_string(result));
+                return {};
+            }
+
+            return pipeline;
+        }
     }
 
     struct Shader::ShaderPimpl
     {
         Device* device = nullptr;
 
-        std::string vertex_file;
-        std::string fragment_file;
+        u32 id = 0;
+
+        ShaderInfo info{};
 
         vk::PipelineLayout layout{};
         vk::Pipeline pipeline{};
+
+        /* Shared with the job building a replacement pipeline, which hands it over through isDone. */
+        struct PipelineBuild
+        {
+            vk::Pipeline Pipeline{};
+            std::atomic<bool> IsDone = false;
+        };
+        Shared<PipelineBuild> build = nullptr;
+        core::JobSystem* jobSystem = nullptr;
+        // Files changed again while a build was running, so another starts once it is installed
+        bool isReloadQueued = false;
+
+        void start_build()
+        {
+            build = CreateShared<PipelineBuild>();
+            isReloadQueued = false;
+
+            // Read here, the device is only used from the main thread
+            jobSystem->submit(
+                [build = build,
+                 vk_device = device->get_device(),
+                 pipeline_cache = device->get_pipeline_cache(),
+                 layout = layout,
+                 color_format = device->get_swapchain_format(),
+                 info = info]
+                {
+                    // Workers do not catch, so a driver error fails the build here instead of terminating the process
+                    try
+                    {
+                        build->Pipeline = create_pipeline(vk_device, pipeline_cache, layout, color_format, info);
+                    }
+                    catch (const std::exception& error)
+                    {
+                        LOG_ERROR(
+                            "Shader - Failed to create pipeline for <{}>, <{}>: {}", info.VertexFile, info.FragmentFile, error.what());
+                        build->Pipeline = nullptr;
+                    }
+
+                    build->IsDone.store(true, std::memory_order_release);
+                    build->IsDone.notify_all();
+                });
+        }
     };
 
     Shader::Shader(Device* device) : m_pimpl(new ShaderPimpl)
     {
         m_pimpl->device = device;
+        m_pimpl->id = s_nextShaderId.fetch_add(1);
     }
 
     Shader::~Shader()
@@ -57,9 +272,19 @@ namespace app::gfx
     }
 
     void Shader::init(const std::string& vertex_file, const std::string& fragment_file)
+    {
+        ShaderInfo info{};
+        info.VertexFile = vertex_file;
+        info.FragmentFile = fragment_file;
+        init(info);
+    }
+
+    void Shader::init(const ShaderInfo& info)
     {
         destroy();
 
+        m_pimpl->info = info;
+
         auto device = m_pimpl->device->get_device();
 
         {
@@ -68,151 +293,65 @@ namespace app::gfx
             const_range.setSize(sizeof(glm::mat4) * 2);
             const_range.setStageFlags(vk::ShaderStageFlagBits::eVertex);
 
-            auto set_layout = m_pimpl->device->get_texture_set_layout();
+            std::vector<vk::DescriptorSetLayout> set_layouts(info.TextureSetCount, m_pimpl->device->get_texture_set_layout());
+            set_layouts.insert(set_layouts.end(), info.TextureArraySetCount, m_pimpl->device->get_texture_array_set_layout());
             vk::PipelineLayoutCreateInfo layout_info{};
             layout_info.setPushConstantRanges(const_range);
-            layout_info.setSetLayouts(set_layout);
+            layout_info.setSetLayouts(set_layouts);
             m_pimpl->layout = device.createPipelineLayout(layout_info);
         }
 
-        auto vert_spv_code = read_spirv_file(vertex_file);
-        if (vert_spv_code.empty())
+        const auto color_format = m_pimpl->device->get_swapchain_format();
+        m_pimpl->pipeline = create_pipeline(device, m_pimpl->device->get_pipeline_cache(), m_pimpl->layout, color_format, info);
+    }
+
+    void Shader::destroy()
+    {
+        if (m_pimpl->build != nullptr)
         {
-            return;
+            // The job still uses the layout, and its pipeline was never drawn with
+            m_pimpl->build->IsDone.wait(false, std::memory_order_acquire);
+            m_pimpl->device->get_device().destroy(m_pimpl->build->Pipeline);
+            m_pimpl->build = nullptr;
         }
-        vk::ShaderModuleCreateInfo moduleInfo{};
-        moduleInfo.setCode(vert_spv_code);
-        vk::ShaderModule vertShaderModule = device.createShaderModule(moduleInfo);
+        m_pimpl->isReloadQueued = false;
 
-        auto frag_spv_code = read_spirv_file(fragment_file);
-        if (frag_spv_code.empty())
+        if (!m_pimpl->layout)
         {
             return;
         }
-        moduleInfo.setCode(frag_spv_code);
-        vk::ShaderModule fragShaderModule = device.createShaderModule(moduleInfo);
-
-        vk::PipelineShaderStageCreateInfo vertShaderStageInfo{};
-        vertShaderStageInfo.stage = vk::ShaderStageFlagBits::eVertex;
-        vertShaderStageInfo.module = vertShaderModule;
-        vertShaderStageInfo.pName = "main";
-
-        vk::PipelineShaderStageCreateInfo fragShaderStageInfo{};
-        fragShaderStageInfo.stage = vk::ShaderStageFlagBits::eFragment;
-        fragShaderStageInfo.module = fragShaderModule;
-        fragShaderStageInfo.pName = "main";
-
-        std::vector<vk::PipelineShaderStageCreateInfo> shaderStages = { vertShaderStageInfo, fragShaderStageInfo };
-
-        std::vector<vk::VertexInputAttributeDescription> attributes(2);
-        attributes[0].setBinding(0);
-        attributes[0].setLocation(0);
-        attributes[0].setFormat(vk::Format::eR32G32Sfloat);
-        attributes[0].setOffset(0);
-        attributes[1].setBinding(0);
-        attributes[1].setLocation(1);
-        attributes[1].setFormat(vk::Format::eR32G32Sfloat);
-        attributes[1].setOffset(8);
-
-        vk::VertexInputBindingDescription binding{};
-        binding.setBinding(0);
-        binding.setInputRate(vk::VertexInputRate::eVertex);
-        binding.setStride(16);
-
-        vk::PipelineVertexInputStateCreateInfo vertexInputInfo{};
-        if (!attributes.empty())
-        {
-            vertexInputInfo.setVertexBindingDescriptions(binding);
-            vertexInputInfo.setVertexAttributeDescriptions(attributes);
-        }
 
-        vk::PipelineInputAssemblyStateCreateInfo inputAssembly{};
-        inputAssembly.topology = vk::PrimitiveTopology::eTriangleList;
-        inputAssembly.primitiveRestartEnable = VK_FALSE;
-
-        vk::Viewport viewport{};
-        vk::Rect2D scissor{};
-
-        vk::PipelineViewportStateCreateInfo viewportState{};
-        viewportState.setViewports(viewport);
-        viewportState.setScissors(scissor);
-
-        vk::PipelineRasterizationStateCreateInfo rasterizer{};
-        rasterizer.depthClampEnable = VK_FALSE;
-        rasterizer.rasterizerDiscardEnable = VK_FALSE;
-        rasterizer.polygonMode = vk::PolygonMode::eFill;
-        rasterizer.lineWidth = 1.0f;
-        rasterizer.cullMode = vk::CullModeFlagBits::eBack;
-        rasterizer.frontFace = vk::FrontFace::eClockwise;
-        rasterizer.depthBiasEnable = VK_FALSE;
-
-        vk::PipelineMultisampleStateCreateInfo multisampling{};
-        multisampling.sampleShadingEnable = VK_FALSE;
-        multisampling.rasterizationSamples = vk::SampleCountFlagBits::e1;
-
-        // Depth/Stencil State
-
-        vk::PipelineColorBlendAttachmentState colorBlendAttachment{};
-        colorBlendAttachment.setBlendEnable(true);
-        colorBlendAttachment.setSrcColorBlendFactor(vk::BlendFactor::eSrcAlpha);
-        colorBlendAttachment.setDstColorBlendFactor(vk::BlendFactor::eOneMinusSrcAlpha);
-        colorBlendAttachment.setColorBlendOp(vk::BlendOp::eAdd);
-        colorBlendAttachment.setSrcAlphaBlendFactor(vk::BlendFactor::eOne);
-        colorBlendAttachment.setDstAlphaBlendFactor(vk::BlendFactor::eOneMinusSrcAlpha);
-        colorBlendAttachment.setAlphaBlendOp(vk::BlendOp::eAdd);
-        colorBlendAttachment.setColorWriteMask(vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
-                                               vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA);
-
-        vk::PipelineColorBlendStateCreateInfo colorBlending{};
-        colorBlending.logicOpEnable = VK_FALSE;
-        colorBlending.attachmentCount = 1;
-        colorBlending.pAttachments = &colorBlendAttachment;
-
-        std::vector dynamicStates = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
-        vk::PipelineDynamicStateCreateInfo dynamicState{};
-        dynamicState.setDynamicStates(dynamicStates);
-
-        vk::Format colorFormat = m_pimpl->device->get_swapchain_format();
-        vk::PipelineRenderingCreateInfo pipelineRenderingInfo{};
-        pipelineRenderingInfo.setColorAttachmentFormats(colorFormat);
-
-        vk::GraphicsPipelineCreateInfo pipeline_info{};
-        pipeline_info.stageCount = static_cast<u32>(shaderStages.size());
-        pipeline_info.pStages = shaderStages.data();
-        pipeline_info.pNext = &pipelineRenderingInfo;
-        pipeline_info.pVertexInputState = &vertexInputInfo;
-        pipeline_info.pInputAssemblyState = &inputAssembly;
-        pipeline_info.pViewportState = &viewportState;
-        pipeline_info.pRasterizationState = &rasterizer;
-        pipeline_info.pMultisampleState = &multisampling;
-        pipeline_info.pDepthStencilState = nullptr;
-        pipeline_info.pColorBlendState = &colorBlending;
-        pipeline_info.pDynamicState = &dynamicState;
-        pipeline_info.layout = m_pimpl->layout;
-        pipeline_info.subpass = 0;
-
-        m_pimpl->pipeline = device.createGraphicsPipeline({}, pipeline_info).value;
-
-        device.destroy(vertShaderModule);
-        device.destroy(fragShaderModule);
+        m_pimpl->device->defer_destroy(
+            [device = m_pimpl->device->get_device(), pipeline = m_pimpl->pipeline, layout = m_pimpl->layout]
+            {
+                device.destroy(pipeline);
+                device.destroy(layout);
+            });
+
+        m_pimpl->pipeline = nullptr;
+        m_pimpl->layout = nullptr;
     }
 
-    void Shader::destroy()
+    bool Shader::is_valid() const
     {
-        if (!m_pimpl->pipeline)
-        {
-            return;
-        }
+        return m_pimpl->pipeline;
+    }
 
-        auto device = m_pimpl->device->get_device();
+    bool Shader::is_reloading() const
+    {
+        return m_pimpl->build != nullptr;
+    }
 
-        device.destroy(m_pimpl->pipeline);
-        device.destroy(m_pimpl->layout);
+    bool Shader::uses_file(const std::filesystem::path& path) const
+    {
+        const auto normal_path = path.lexically_normal();
+        return std::filesystem::path(m_pimpl->info.VertexFile).lexically_normal() == normal_path ||
+               std::filesystem::path(m_pimpl->info.FragmentFile).lexically_normal() == normal_path;
     }
 
-    bool Shader::is_valid() const
+    auto Shader::get_id() const -> u32
     {
-        return m_pimpl->pipeline;
+        return m_pimpl->id;
     }
 
     auto Shader::get_layout() const -> vk::PipelineLayout
@@ -225,4 +364,48 @@ namespace app::gfx
         return m_pimpl->pipeline;
     }
 
+    void Shader::reload_async(core::JobSystem& job_system)
+    {
+        ASSERT(m_pimpl->layout);
+
+        m_pimpl->jobSystem = &job_system;
+        if (m_pimpl->build != nullptr)
+        {
+            // The running build may have read the files before they changed
+            m_pimpl->isReloadQueued = true;
+            return;
+        }
+
+        m_pimpl->start_build();
+    }
+
+    auto Shader::update() -> bool
+    {
+        if (m_pimpl->build == nullptr || !m_pimpl->build->IsDone.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        const auto pipeline = m_pimpl->build->Pipeline;
+        m_pimpl->build = nullptr;
+
+        if (m_pimpl->isReloadQueued)
+        {
+            m_pimpl->start_build();
+        }
+
+        if (!pipeline)
+        {
+            const auto& info = m_pimpl->info;
+            LOG_ERROR("Shader - Failed to rebuild <{}>, <{}>, keeping the previous pipeline!", info.VertexFile, info.FragmentFile);
+            return false;
+        }
+
+        // Frames in flight may have bound the old pipeline
+        m_pimpl->device->defer_destroy(
+            [device = m_pimpl->device->get_device(), old_pipeline = m_pimpl->pipeline] { device.destroy(old_pipeline); });
+        m_pimpl->pipeline = pipeline;
+        return true;
+    }
+
 }
@@ -4,12 +4,35 @@
 
 #include <vulkan/vulkan.hpp>
 
+#include <filesystem>
 #include <string>
+#include <vector>
+
+namespace app::core
+{
+    class JobSystem;
+}
 
 namespace app::gfx
 {
     class Device;
 
+    struct ShaderInfo
+    {
+        std::string VertexFile{};
+        std::string FragmentFile{};
+
+        // Attribute formats for locations 0..n, packed in order into one vertex binding. Empty if the shader makes its own vertices.
+        std::vector<vk::Format> VertexAttributes{ vk::Format::eR32G32Sfloat, vk::Format::eR32G32Sfloat };
+        // eInstance steps the vertex binding once per instance
+        vk::VertexInputRate VertexInputRate = vk::VertexInputRate::eVertex;
+
+        // Number of texture sets, bound as set = 0..TextureSetCount - 1
+        u32 TextureSetCount = 1;
+        // Number of texture array sets (see Renderer::bind_textures()), bound after the texture sets
+        u32 TextureArraySetCount = 0;
+    };
+
     class Shader
     {
     public:
@@ -19,17 +42,32 @@ namespace app::gfx
         /* Initialisation/Destruction */
 
         void init(const std::string& vertex_file, const std::string& fragment_file);
+        void init(const ShaderInfo& info);
+        /* Waits for a reload in progress. */
         void destroy();
 
         /* Getters */
 
         bool is_valid() const;
+        bool is_reloading() const;
+        bool uses_file(const std::filesystem::path& path) const;
+
+        /* Unique for the lifetime of the application, used to sort draws by shader. */
+        auto get_id() const -> u32;
 
         auto get_layout() const -> vk::PipelineLayout;
         auto get_pipeline() const -> vk::Pipeline;
 
         /* Commands */
 
+        /**
+         * Rebuilds the pipeline from the shader's files on a worker thread. The current pipeline stays in use until update()
+         * swaps the new one in, and is kept if the rebuild fails.
+         */
+        void reload_async(core::JobSystem& job_system);
+        /* Swaps in a finished reload. Returns true if the pipeline changed, which only happens here, between draws. */
+        auto update() -> bool;
+
     private:
         struct ShaderPimpl;
         Owned<ShaderPimpl> m_pimpl = nullptr;
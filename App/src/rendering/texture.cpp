@@ -8,12 +8,35 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#include <atomic>
+
 namespace app::gfx
 {
+    namespace
+    {
+        std::atomic<u32> s_nextTextureId = 1;
+
+        auto get_texel_size(vk::Format format) -> u32
+        {
+            switch (format)
+            {
+                case vk::Format::eR8Uint:
+                case vk::Format::eR8Unorm: return 1;
+                case vk::Format::eR16Uint: return 2;
+                case vk::Format::eR8G8B8A8Unorm:
+                case vk::Format::eR8G8B8A8Srgb: return 4;
+                case vk::Format::eR32G32B32A32Sfloat: return 16;
+                default: ASSERT(false); return 0;
+            }
+        }
+    }
+
     struct Texture::TexturePimpl
     {
         Device* device = nullptr;
 
+        u32 id = 0;
+
         u32 width = 0;
         u32 height = 0;
         vk::Format format{};
@@ -28,6 +51,7 @@ namespace app::gfx
     Texture::Texture(Device* device) : m_pimpl(new TexturePimpl)
     {
         m_pimpl->device = device;
+        m_pimpl->id = s_nextTextureId.fetch_add(1);
     }
 
     Texture::~Texture()
@@ -36,18 +60,30 @@ namespace app::gfx
     }
 
     void Texture::init(const std::string& filename)
+    {
+        int w, h, c;
+        byte* data = stbi_load(filename.c_str(), &w, &h, &c, 4);
+        if (data == nullptr)
+        {
+            LOG_ERROR("Texture - Failed to load image <{}>!", filename);
+            return;
+        }
+
+        init(static_cast<u32>(w), static_cast<u32>(h), vk::Format::eR8G8B8A8Srgb, data);
+
+        stbi_image_free(data);
+    }
+
+    void Texture::init(u32 width, u32 height, vk::Format format, const void* data)
     {
         destroy();
 
         auto device = m_pimpl->device->get_device();
         auto allocator = m_pimpl->device->get_allocator();
 
-        int w, h, c;
-        byte* data = stbi_load(filename.c_str(), &w, &h, &c, 4);
-
-        m_pimpl->width = w;
-        m_pimpl->height = h;
-        m_pimpl->format = vk::Format::eR8G8B8A8Srgb;
+        m_pimpl->width = width;
+        m_pimpl->height = height;
+        m_pimpl->format = format;
 
         vk::ImageCreateInfo image_info{};
         image_info.imageType = vk::ImageType::e2D;
@@ -65,7 +101,7 @@ namespace app::gfx
         vmaCreateImage(allocator, &vk_image_info, &alloc_info, &vk_image, &m_pimpl->allocation, nullptr);
         m_pimpl->image = vk_image;
 
-        auto data_size = static_cast<sizet>(w * h * 4);
+        auto data_size = static_cast<sizet>(width) * height * get_texel_size(format);
         m_pimpl->device->upload_to_image(m_pimpl->image, image_info.extent, data_size, data);
 
         vk::ImageViewCreateInfo view_info{};
@@ -107,17 +143,24 @@ namespace app::gfx
             return;
         }
 
-        auto device = m_pimpl->device->get_device();
-        auto allocator = m_pimpl->device->get_allocator();
-
-        device.destroy(m_pimpl->view);
-        device.freeDescriptorSets(m_pimpl->device->get_descriptor_pool(), m_pimpl->set);
-
-        vmaDestroyImage(allocator, m_pimpl->image, m_pimpl->allocation);
+        m_pimpl->device->defer_destroy(
+            [device = m_pimpl->device->get_device(),
+             allocator = m_pimpl->device->get_allocator(),
+             descriptor_pool = m_pimpl->device->get_descriptor_pool(),
+             image = m_pimpl->image,
+             allocation = m_pimpl->allocation,
+             view = m_pimpl->view,
+             set = m_pimpl->set]
+            {
+                device.destroy(view);
+                device.freeDescriptorSets(descriptor_pool, set);
+                vmaDestroyImage(allocator, image, allocation);
+            });
 
         m_pimpl->image = nullptr;
         m_pimpl->allocation = nullptr;
         m_pimpl->view = nullptr;
+        m_pimpl->set = nullptr;
         m_pimpl->width = 0;
         m_pimpl->height = 0;
     }
@@ -127,6 +170,11 @@ namespace app::gfx
         return m_pimpl->image && m_pimpl->set;
     }
 
+    auto Texture::get_id() const -> u32
+    {
+        return m_pimpl->id;
+    }
+
     auto Texture::get_width() const -> u32
     {
         return m_pimpl->width;
@@ -142,4 +190,20 @@ namespace app::gfx
         return m_pimpl->set;
     }
 
+    auto Texture::get_view() const -> vk::ImageView
+    {
+        return m_pimpl->view;
+    }
+
+    void Texture::write_region(const glm::uvec2& offset, const glm::uvec2& extent, const void* data)
+    {
+        ASSERT(is_valid());
+        ASSERT(offset.x + extent.x <= m_pimpl->width && offset.y + extent.y <= m_pimpl->height);
+
+        const vk::Offset3D region_offset{ static_cast<i32>(offset.x), static_cast<i32>(offset.y), 0 };
+        const vk::Extent3D region_extent{ extent.x, extent.y, 1 };
+        const auto data_size = static_cast<sizet>(extent.x) * extent.y * get_texel_size(m_pimpl->format);
+        m_pimpl->device->update_image_region(m_pimpl->image, region_offset, region_extent, data_size, data);
+    }
+
 }
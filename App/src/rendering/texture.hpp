@@ -10,6 +10,9 @@ namespace app::gfx
 {
     class Device;
 
+    /* Textures per array set bound with Renderer::bind_textures(). 16 is the per-stage sampler count every Vulkan device supports. */
+    constexpr u32 TextureArraySize = 16;
+
     class Texture
     {
     public:
@@ -17,16 +20,27 @@ namespace app::gfx
         ~Texture();
 
         void init(const std::string& filename);
+        /* Creates a sampled texture from tightly packed texels. Supports 8/16-bit single channel, RGBA8 and RGBA32F formats. */
+        void init(u32 width, u32 height, vk::Format format, const void* data);
         void destroy();
 
         /* Getters */
 
         bool is_valid() const;
 
+        /* Unique for the lifetime of the application, used to sort draws by texture. */
+        auto get_id() const -> u32;
+
         auto get_width() const -> u32;
         auto get_height() const -> u32;
 
         auto get_set() const -> vk::DescriptorSet;
+        auto get_view() const -> vk::ImageView;
+
+        /* Commands */
+
+        /* Replaces a rectangle of texels. The copy runs with the open upload batch, or else ahead of the next frame submitted. */
+        void write_region(const glm::uvec2& offset, const glm::uvec2& extent, const void* data);
 
     private:
         struct TexturePimpl;
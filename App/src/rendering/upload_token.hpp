@@ -0,0 +1,12 @@
+#pragma once
+
+#include "core/core.hpp"
+
+namespace app::gfx
+{
+    /* Identifies a submitted upload batch. A default token refers to no batch and is always complete. */
+    struct UploadToken
+    {
+        u64 Value = 0;
+    };
+}
@@ -0,0 +1,17 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) in vec4 in_color;
+layout(location = 1) in vec2 in_texCoord;
+layout(location = 2) flat in uint in_texIndex;
+
+layout(location = 0) out vec4 frag_color;
+
+// Must match TextureArraySize
+layout(set = 0, binding = 0) uniform sampler2D u_textures[16];
+
+void main()
+{
+    // The index can differ between sprites in one draw
+    frag_color = texture(u_textures[nonuniformEXT(in_texIndex)], in_texCoord) * in_color;
+}
@@ -0,0 +1,40 @@
+#version 450
+
+// One sprite instance per quad
+layout(location = 0) in vec2 in_position;
+layout(location = 1) in vec2 in_size;
+layout(location = 2) in vec4 in_uvRect;
+layout(location = 3) in vec4 in_color;
+// Texture index, rotation as 16-bit unorm of a full turn
+layout(location = 4) in uvec2 in_texIndexRotation;
+
+layout(location = 0) out vec4 out_color;
+layout(location = 1) out vec2 out_texCoord;
+layout(location = 2) flat out uint out_texIndex;
+
+layout(push_constant) uniform PushBlock
+{
+    mat4 viewProj;
+    mat4 transform;
+} u_consts;
+
+// Unit quad, two triangles
+const vec2 c_corners[6] = vec2[](vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0), vec2(1.0, 1.0), vec2(0.0, 1.0), vec2(0.0, 0.0));
+
+void main()
+{
+    vec2 corner = c_corners[gl_VertexIndex];
+
+    // Rotate about the quad's centre
+    float angle = float(in_texIndexRotation.y) / 65535.0 * 6.28318530718;
+    vec2 offset = (corner - 0.5) * in_size;
+    float s = sin(angle);
+    float c = cos(angle);
+    vec2 position = in_position + 0.5 * in_size + vec2(offset.x * c - offset.y * s, offset.x * s + offset.y * c);
+
+    gl_Position = u_consts.viewProj * u_consts.transform * vec4(position, 0.0, 1.0);
+
+    out_color = in_color;
+    out_texCoord = mix(in_uvRect.xy, in_uvRect.zw, corner);
+    out_texIndex = in_texIndexRotation.x;
+}
@@ -0,0 +1,13 @@
+#version 450
+
+layout(location = 0) in vec2 in_chunkUV;
+
+layout(location = 0) out vec4 frag_color;
+
+// Average sprite colour per tile of the chunk
+layout(set = 0, binding = 0) uniform sampler2D u_impostor;
+
+void main()
+{
+    frag_color = texture(u_impostor, in_chunkUV);
+}
@@ -0,0 +1,24 @@
+#version 450
+
+layout(location = 0) in vec2 in_tileCoord;
+layout(location = 1) flat in uint in_sprite;
+
+layout(location = 0) out vec4 frag_color;
+
+layout(set = 0, binding = 0) uniform sampler2D u_atlas;
+// Atlas UV rectangle (min.xy, max.xy) per sprite
+layout(set = 1, binding = 0) uniform sampler2D u_spriteUVs;
+
+void main()
+{
+    vec4 uv_rect = texelFetch(u_spriteUVs, ivec2(in_sprite, 0), 0);
+    vec2 uv_size = uv_rect.zw - uv_rect.xy;
+
+    // Repeat the sprite once per tile within its atlas rectangle
+    vec2 uv = uv_rect.xy + fract(in_tileCoord) * uv_size;
+
+    // Gradients from the unwrapped coordinate, so the jump at each tile edge does not select a tiny mip
+    vec2 dx = dFdx(in_tileCoord) * uv_size;
+    vec2 dy = dFdy(in_tileCoord) * uv_size;
+    frag_color = textureGrad(u_atlas, uv, dx, dy);
+}
@@ -0,0 +1,22 @@
+#version 450
+
+// Local tile x, local tile y, sprite index, unused
+layout(location = 0) in uvec4 in_vertex;
+
+layout(location = 0) out vec2 out_tileCoord;
+layout(location = 1) flat out uint out_sprite;
+
+layout(push_constant) uniform PushBlock
+{
+    mat4 viewProj;
+    mat4 transform;
+} u_consts;
+
+void main()
+{
+    vec2 position = vec2(in_vertex.xy);
+    gl_Position = u_consts.viewProj * u_consts.transform * vec4(position, 0.0, 1.0);
+
+    out_tileCoord = position;
+    out_sprite = in_vertex.z;
+}
@@ -0,0 +1,30 @@
+#version 450
+
+// Local tile x, local tile y, sprite index, size in tiles
+layout(location = 0) in uvec4 in_tile;
+
+layout(location = 0) out vec2 out_texCoord;
+
+layout(push_constant) uniform PushBlock
+{
+    mat4 viewProj;
+    mat4 transform;
+} u_consts;
+
+// Atlas UV rectangle (min.xy, max.xy) per sprite
+layout(set = 1, binding = 0) uniform sampler2D u_spriteUVs;
+
+// Unit quad with the same winding as the world meshes
+const vec2 c_corners[6] = vec2[](vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0), vec2(1.0, 1.0), vec2(0.0, 1.0), vec2(0.0, 0.0));
+
+void main()
+{
+    vec2 corner = c_corners[gl_VertexIndex];
+
+    // A size of 0 collapses the quad for empty tiles
+    vec2 position = vec2(in_tile.xy) + corner * float(in_tile.w);
+    gl_Position = u_consts.viewProj * u_consts.transform * vec4(position, 0.0, 1.0);
+
+    vec4 uv_rect = texelFetch(u_spriteUVs, ivec2(in_tile.z, 0), 0);
+    out_texCoord = mix(uv_rect.xy, uv_rect.zw, corner);
+}
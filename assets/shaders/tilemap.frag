@@ -0,0 +1,29 @@
+#version 450
+
+layout(location = 0) in vec2 in_chunkUV;
+
+layout(location = 0) out vec4 frag_color;
+
+layout(set = 0, binding = 0) uniform sampler2D u_atlas;
+// Atlas UV rectangle (min.xy, max.xy) per tile type
+layout(set = 1, binding = 0) uniform sampler2D u_spriteUVs;
+// Tile type per tile of the chunk
+layout(set = 2, binding = 0) uniform usampler2D u_tiles;
+
+void main()
+{
+    ivec2 tile_count = textureSize(u_tiles, 0);
+    vec2 tile_pos = in_chunkUV * vec2(tile_count);
+    ivec2 tile = clamp(ivec2(tile_pos), ivec2(0), tile_count - 1);
+
+    uint tile_type = texelFetch(u_tiles, tile, 0).r;
+    if (tile_type == 0u)
+    {
+        discard;
+    }
+
+    vec4 uv_rect = texelFetch(u_spriteUVs, ivec2(tile_type, 0), 0);
+    vec2 uv = mix(uv_rect.xy, uv_rect.zw, fract(tile_pos));
+
+    frag_color = texture(u_atlas, uv);
+}
@@ -0,0 +1,20 @@
+#version 450
+
+layout(location = 0) out vec2 out_chunkUV;
+
+layout(push_constant) uniform PushBlock
+{
+    mat4 viewProj;
+    mat4 transform;
+} u_consts;
+
+// Unit quad with the same winding as the world meshes, transform scales it over a chunk
+const vec2 c_corners[6] = vec2[](vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0), vec2(1.0, 1.0), vec2(0.0, 1.0), vec2(0.0, 0.0));
+
+void main()
+{
+    vec2 corner = c_corners[gl_VertexIndex];
+    gl_Position = u_consts.viewProj * u_consts.transform * vec4(corner, 0.0, 1.0);
+
+    out_chunkUV = corner;
+}
@@ -0,0 +1,11 @@
+@echo off
+
+rem Compiles every GLSL shader in assets/shaders to SPIR-V next to its source, then validates it for Vulkan 1.3
+pushd ..\assets\shaders
+for %%f in (*.vert *.frag) do (
+    echo %%f
+    "%VULKAN_SDK%\Bin\glslc.exe" %%f -o %%f.spv
+    "%VULKAN_SDK%\Bin\spirv-val.exe" --target-env vulkan1.3 %%f.spv
+)
+popd
+pause